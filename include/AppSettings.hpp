@@ -20,6 +20,12 @@ public:
     int projectTreeFontSize() const { return m_projectTreeFontSize; }
     QString terminalFontFamily() const { return m_terminalFontFamily; }
     int terminalFontSize() const { return m_terminalFontSize; }
+    // Lines of output the terminal keeps before dropping the oldest
+    int terminalScrollbackLines() const { return m_terminalScrollbackLines; }
+    // Files at least this large (in MB) open in the large-file editor
+    int largeFileThresholdMB() const { return m_largeFileThresholdMB; }
+    // Keep a trigram index of the open project for find in files
+    bool searchIndexEnabled() const { return m_searchIndexEnabled; }
     QFont font() const;
     
     // Setters
@@ -30,6 +36,9 @@ public:
     void setProjectTreeFontSize(int size);
     void setTerminalFontFamily(const QString& family);
     void setTerminalFontSize(int size);
+    void setTerminalScrollbackLines(int lines);
+    void setLargeFileThresholdMB(int megabytes);
+    void setSearchIndexEnabled(bool isEnabled);
     
     // Config file operations
     bool loadFromFile();
@@ -47,6 +56,9 @@ private:
     int m_projectTreeFontSize;
     QString m_terminalFontFamily;
     int m_terminalFontSize;
+    int m_terminalScrollbackLines;
+    int m_largeFileThresholdMB;
+    bool m_searchIndexEnabled;
     
     void setDefaults();
 };
@@ -11,6 +11,7 @@
 #include "code/CodeEditor.hpp"
 #include "code/CodeTabPane.hpp"
 #include "terminal/TerminalFrontend.hpp"
+#include "search/SearchPanel.hpp"
 
 #include <QMainWindow>
 #include <QMenu>
@@ -44,8 +45,14 @@ public:
     void setProjectTitle(const QString& projectName);
     QString getCurrentProjectRoot() const { return m_currentProjectRoot; }
     void updateSplitterStyles(bool isDarkTheme);
+    // Show the find in files panel, searching the current project
+    void showSearchPanel();
     ~MainWindow();
 
+protected:
+    // Saves the project session
+    void closeEvent(QCloseEvent* event) override;
+
 private slots:
     void onProjectOpened(const QString& projectPath, const QString& projectName);
     void toggleProjectTree();
@@ -60,6 +67,7 @@ private:
     QAction* m_toggleTreeAction;
     openide::ProjectTree m_projectTree;
     openide::code::CodeTabPane m_codeTabPane;
+    openide::search::SearchPanel m_searchPanel;
     openide::menu::FileMenu m_fileMenu;
     openide::menu::EditMenu m_editMenu;
     openide::menu::ThemeMenu m_themeMenu;
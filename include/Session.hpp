@@ -0,0 +1,27 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include <QString>
+#include <QJsonObject>
+
+namespace openide
+{
+// Per-project record of the open tabs and pane layout, stored as JSON next
+// to the app config (see CodeTabPane::saveSession for the contents)
+class Session
+{
+public:
+    // Load the session saved for the project at projectRoot; empty if none
+    static QJsonObject load(const QString& projectRoot);
+    static bool save(const QString& projectRoot, const QJsonObject& session);
+    
+    // Session file for the project at projectRoot
+    static QString getSessionFilePath(const QString& projectRoot);
+    
+    // Read a file on the thread pool so its pages are cached by the time an
+    // editor loads it; prefetches of different files run in parallel
+    static void prefetch(const QString& path);
+};
+}
+
+#endif // SESSION_HPP
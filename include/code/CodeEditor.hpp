@@ -4,10 +4,10 @@
 // forward decl
 class MainWindow;
 namespace openide { class AppSettings; }
-namespace openide::code { class FindReplaceDialog; }
+namespace openide::code { class FindReplaceDialog; class LargeFileView; }
 
 #include "FileType.hpp"
-#include "SyntaxHighlighter.hpp"
+#include "code/EditorDocument.hpp"
 
 #include <QPlainTextEdit>
 #include <QWidget>
@@ -19,6 +19,10 @@ namespace openide::code { class FindReplaceDialog; }
 #include <QPaintEvent>
 #include <QKeyEvent>
 #include <QWheelEvent>
+#include <QElapsedTimer>
+#include <memory>
+
+class QProgressBar;
 
 namespace openide::code
 {
@@ -34,34 +38,90 @@ public:
     void applySettings(openide::AppSettings* settings);
     const QString& getFilePath() const;
     void loadFile(const QString& path, enum FileType fileType);
-    void saveFile() const;
+    // Show the same document as source (for split views): edits appear in
+    // both, while the cursor and scroll position stay per view
+    void shareDocument(CodeEditor* source);
+    // Point the editor at a file without reading it. It stays a placeholder,
+    // with an empty document, until ensureLoaded() or it is first shown.
+    void setFile(const QString& path, enum FileType fileType);
+    // Read the file if this is a placeholder, or share source's document
+    // when given another loaded view of the same file
+    void ensureLoaded(CodeEditor* source = nullptr);
+    // Turn an unmodified editor back into a placeholder, releasing its
+    // document and highlight state; the cursor and scroll position are
+    // restored when it loads again. Returns false if it can't be unloaded.
+    bool unload();
+    bool isUnloaded() const;
+    // Milliseconds since the editor was last visible, -1 while it is shown
+    qint64 hiddenFor() const;
+    // Cursor position and vertical scroll value, kept while unloaded.
+    // setViewState() takes effect once the file has loaded.
+    int cursorPosition() const;
+    int scrollPosition() const;
+    void setViewState(int cursorPosition, int scrollPosition);
+    // Put the cursor at the start of a 0-based line and centre it, once the
+    // file has loaded
+    void goToLine(int line);
+    // Save asynchronously; saveFinished reports the outcome
+    void saveFile();
     void setModified(bool isModified);
     bool isModified() const;
     void updateTheme(bool isDarkTheme);
     void showFindReplaceDialog();
+    // Whether loadFile() is still filling the document in the background
+    bool isLoading() const;
+    // Non-null when the file was too large for QTextDocument and is shown
+    // by a LargeFileView instead
+    LargeFileView* largeFileView() const;
     ~CodeEditor();
     
 signals:
     void fileModified();
+    void saveFinished(bool succeeded, const QString& error);
+    // A placeholder is being shown and is about to load; a handler may call
+    // ensureLoaded() with a view to share
+    void loadRequested();
+    // ensureLoaded() couldn't read the file; the editor stays a placeholder
+    void loadFailed();
 protected:
     void resizeEvent(QResizeEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
     void keyPressEvent(QKeyEvent* event) override;
     void wheelEvent(QWheelEvent* event) override;
 private slots:
     void updateLineNumberAreaWidth(int newBlockCount);
     void highlightCurrentLine();
     void updateLineNumberArea(const QRect& rect, int dy);
+    void updateHighlightViewport();
+    void updateLoadState();
 private:
     int lineNumberAreaWidth();
     void lineNumberAreaPaintEvent(QPaintEvent* event);
+    void attachDocument(std::shared_ptr<EditorDocument> document);
+    void openLargeFile(const QString& path);
+    void restoreViewState();
     
     MainWindow* m_parent;
     bool m_isDarkTheme;
     bool m_isModified;
     QString m_filePath;
-    openide::SyntaxHighlighter m_syntaxHighlighter;
+    std::shared_ptr<EditorDocument> m_document;  // shared with split views of the same file
     LineNumberArea* m_lineNumberArea;
     FindReplaceDialog* m_findReplaceDialog;
+    QProgressBar* m_loadProgressBar;
+    
+    LargeFileView* m_largeFileView;
+    qint64 m_largeFileThreshold;  // bytes
+    
+    // Placeholder state
+    FileType m_fileType;
+    bool m_isUnloaded;
+    bool m_hasSavedViewState;     // restore the position below once loaded
+    int m_savedCursorPosition;
+    int m_savedScrollValue;
+    int m_pendingLine;            // from goToLine(), -1 if none
+    QElapsedTimer m_hiddenTimer;  // invalid while shown
 };
 
 class LineNumberArea : public QWidget
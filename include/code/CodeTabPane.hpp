@@ -17,6 +17,10 @@
 #include <QMimeData>
 #include <QDrag>
 #include <QTabBar>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QJsonObject>
 
 // forward decl
 class MainWindow;
@@ -32,10 +36,21 @@ public:
   void saveActiveFile();
   void saveAllActiveFiles();
   bool fileIsOpen(const QString& path) const;
+  // Bring up the tab for path, opening it if needed, and go to a 0-based
+  // line (-1 to leave the cursor alone)
+  void openFile(const QString& path, int line = -1);
   void updateAllEditorsTheme(bool isDarkTheme);
   void updateAllEditorsSettings(openide::AppSettings* settings);
   void updateAllSplitterStyles(bool isDarkTheme);
   
+  // Pane layout, tabs, cursors and scroll positions as JSON, for Session.
+  // Restoring a valid session replaces all open tabs, unsaved or not, with
+  // placeholders that load when shown; anything else leaves them alone.
+  QJsonObject saveSession() const;
+  void restoreSession(const QJsonObject& session);
+  static bool isValidSession(const QJsonObject& session);
+  bool hasUnsavedChanges() const;
+  
   // For compatibility with external code expecting QTabWidget interface
   int count() const;
   QWidget* widget(int index) const;
@@ -66,6 +81,15 @@ private:
   void setupTabWidget(QTabWidget* tabWidget);
   void connectEditorSignals(CodeEditor* editor, QTabWidget* tabWidget);
   CodeEditor* duplicateEditor(CodeEditor* source);
+  void registerEditor(CodeEditor* editor);
+  void unregisterEditor(CodeEditor* editor);
+  void materializeEditor(CodeEditor* editor);
+  // Flag the tabs showing editor as unable to load its file, or clear that
+  void markLoadFailed(CodeEditor* editor, bool failed);
+  void unloadHiddenEditors();
+  QJsonObject saveContainer(PaneContainer* container) const;
+  void restoreContainer(PaneContainer* container, const QJsonObject& node);
+  static QString canonicalPath(const QString& path);
   PaneContainer* findContainerForTabWidget(QTabWidget* tabWidget);
   QTabWidget* getActiveTabWidget();
   void updatePaneNumbers();
@@ -84,6 +108,16 @@ private:
   // For drag and drop between panes
   QTabWidget* m_dragSourcePane;
   int m_dragSourceIndex;
+  
+  // Registry of open editors, so lookups and broadcasts don't walk the pane
+  // tree. Moving a tab between panes leaves both maps unchanged.
+  QHash<CodeEditor*, QString> m_editorPaths;             // editor -> canonical path
+  QHash<QString, QList<CodeEditor*>> m_editorsByPath;    // canonical path -> its views
+  
+  // Unmodified editors hidden this long go back to being placeholders
+  static constexpr int UnloadCheckIntervalMs = 60 * 1000;
+  static constexpr qint64 UnloadAfterHiddenMs = 10 * 60 * 1000;
+  QTimer* m_unloadTimer;
 };
 } // namespace openide::code
 #endif // CODETABPANE_HPP
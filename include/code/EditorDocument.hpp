@@ -0,0 +1,85 @@
+#ifndef EDITORDOCUMENT_HPP
+#define EDITORDOCUMENT_HPP
+
+#include "FileType.hpp"
+#include "SyntaxHighlighter.hpp"
+
+#include <QObject>
+#include <QFile>
+#include <QTextDocument>
+#include <QTimer>
+#include <QStringDecoder>
+
+namespace openide::code
+{
+// The text of an open file together with its highlight state. Every
+// CodeEditor showing the file (one per split) holds a shared_ptr to the same
+// EditorDocument, so the text is stored and parsed once however many views
+// there are; cursors and scroll positions stay with each view.
+class EditorDocument : public QObject
+{
+    Q_OBJECT
+public:
+    EditorDocument();
+    ~EditorDocument();
+    
+    QTextDocument* document() { return &m_document; }
+    openide::SyntaxHighlighter& highlighter() { return m_highlighter; }
+    
+    // Start filling the document from path. The first screenful is read
+    // before returning; the rest follows between events. Returns false if
+    // the file can't be opened.
+    bool load(const QString& path, enum FileType fileType);
+    // Whether load() is still filling the document in the background
+    bool isLoading() const { return m_isLoading; }
+    // Percentage of the file read so far
+    int loadProgress() const;
+    
+signals:
+    void loadProgressChanged(int percent);
+    void loadFinished();
+    
+private slots:
+    void loadNextChunk();
+    
+private:
+    // Look the file up in HighlightCache on the thread pool
+    void lookUpCachedHighlights(const QString& path, enum FileType fileType);
+    void onCacheLookup(int generation, const QByteArray& key, bool found,
+                       const openide::code::HighlightIndex& index);
+    // Hand the lookup result to the highlighter, once the text is complete
+    void applyCacheLookup();
+
+    void appendLoadChunk(qint64 chunkSize);
+    void finishLoad();
+    void cancelLoad();
+    
+    // Bytes decoded before the editor is first shown, then per event loop pass
+    static constexpr qint64 FirstLoadChunkSize = 64 * 1024;
+    static constexpr qint64 LoadChunkSize = 512 * 1024;
+    
+    // Declared first so the highlighter detaches before the document goes
+    QTextDocument m_document;
+    openide::SyntaxHighlighter m_highlighter;
+    
+    // Progressive loading state; the file stays mapped until it is fully read
+    bool m_isLoading;
+    QFile m_loadFile;
+    QByteArray m_loadBuffer;   // fallback copy when the file can't be mapped
+    const uchar* m_loadData;
+    qint64 m_loadSize;
+    qint64 m_loadOffset;
+    bool m_loadPendingCR;      // chunk ended in '\r' that may start a CRLF
+    QStringDecoder m_loadDecoder;
+    QTimer m_loadTimer;
+    
+    // Highlight cache lookup for the current load
+    int m_loadGeneration;      // bumped by every load(), so stale lookups are ignored
+    bool m_hasCacheLookup;
+    QByteArray m_cacheKey;
+    bool m_cacheFound;
+    int m_loadedRevision;      // document revision when loading finished
+    openide::code::HighlightIndex m_cachedIndex;
+};
+}
+#endif // EDITORDOCUMENT_HPP
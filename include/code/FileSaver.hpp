@@ -0,0 +1,40 @@
+#ifndef FILESAVER_HPP
+#define FILESAVER_HPP
+
+#include <QIODevice>
+#include <QObject>
+#include <QString>
+#include <functional>
+
+class QThreadPool;
+
+namespace openide::code
+{
+// Writes files on a background pool. Each save goes to a temporary file that
+// replaces the target only once it is complete (QSaveFile), so a crash or a
+// full disk never leaves a truncated file behind. Saves of the same path are
+// committed in the order they were made.
+class FileSaver
+{
+public:
+    // Writes a snapshot of the document; runs on a pool thread
+    using Writer = std::function<bool(QIODevice* device)>;
+    // Reports the outcome; runs on the GUI thread
+    using Callback = std::function<void(bool succeeded, const QString& error)>;
+    
+    // Save to path with writer. context must live on the GUI thread; the
+    // callback is dropped if it is destroyed before the save finishes.
+    static void save(const QString& path, QIODevice::OpenMode mode, Writer writer,
+                     QObject* context, Callback callback);
+    
+    // Writer that encodes text as UTF-8 a slice at a time, so the encoded
+    // copy never has to exist in full
+    static Writer textWriter(const QString& text);
+    
+private:
+    static QThreadPool* pool();
+    // Called as a save of key finishes: start the next one queued for it
+    static void startNext(const QString& key);
+};
+}
+#endif // FILESAVER_HPP
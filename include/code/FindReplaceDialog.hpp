@@ -6,6 +6,8 @@
 #include <QPushButton>
 #include <QCheckBox>
 #include <QLabel>
+#include <QTextDocument>
+#include <QTextCursor>
 
 // forward decl
 namespace openide::code { class CodeEditor; }
@@ -28,6 +30,13 @@ private:
     void setupUI();
     bool findText(const QString& text, bool forward = true);
     
+    // Editor operations, routed to the large-file view when there is one
+    bool editorFind(const QString& text, QTextDocument::FindFlags flags);
+    void editorMoveCursor(QTextCursor::MoveOperation operation);
+    QString editorSelectedText() const;
+    // Returns false if the editor can't be edited yet
+    bool editorInsertText(const QString& text);
+    
     CodeEditor* m_editor;
     QLineEdit* m_findLineEdit;
     QLineEdit* m_replaceLineEdit;
@@ -0,0 +1,40 @@
+#ifndef HIGHLIGHTCACHE_HPP
+#define HIGHLIGHTCACHE_HPP
+
+#include "FileType.hpp"
+#include "code/HighlightIndex.hpp"
+#include <QByteArray>
+#include <QString>
+
+namespace openide::code
+{
+// On-disk cache of whole-file highlights, in the config directory. Entries
+// are keyed by the file's content hash together with the fingerprint of the
+// grammar and query that produced them, so an unchanged file opened with an
+// unchanged grammar can be colored before tree-sitter has run. All functions
+// do file I/O and are meant for the thread pool.
+class HighlightCache
+{
+public:
+    // Key for a file with the given content hash, highlighted as fileType.
+    // Empty if the language has no highlight query. May compile the query.
+    static QByteArray key(const QByteArray& contentHash, openide::FileType fileType);
+    
+    // Content hash of the file at path, empty if it can't be read
+    static QByteArray hashFile(const QString& path);
+    
+    static bool load(const QByteArray& key, HighlightIndex& index);
+    static void store(const QByteArray& key, const HighlightIndex& index);
+    
+private:
+    static QString directory();
+    static QString filePath(const QByteArray& key);
+    // Write an entry holding data to path; false on failure
+    static bool write(const QString& path, const QByteArray& data);
+    // Delete the least recently used entries beyond MaxCacheBytes
+    static void prune();
+    
+    static constexpr qint64 MaxCacheBytes = 256 * 1024 * 1024;
+};
+}
+#endif // HIGHLIGHTCACHE_HPP
@@ -0,0 +1,51 @@
+#ifndef HIGHLIGHTINDEX_HPP
+#define HIGHLIGHTINDEX_HPP
+
+#include "code/TreeSitterWrapper.hpp"
+#include <QByteArray>
+#include <QVector>
+
+namespace openide::code
+{
+// Highlights bucketed by line, so highlighting one block only touches the
+// spans on that line instead of every capture in the file
+class HighlightIndex
+{
+public:
+    struct Span
+    {
+        int start;  // column within the line
+        int end;    // column within the line, -1 = to the end of the line
+        HighlightType type;
+    };
+    
+    struct SpanRange
+    {
+        const Span* first;
+        const Span* last;
+        const Span* begin() const { return first; }
+        const Span* end() const { return last; }
+    };
+    
+    // Rebuild from parser output. Spans keep capture order within each line,
+    // so later captures still take precedence when formats are applied.
+    // Given rows [firstRow, lastRow] (e.g. the viewport the query was limited
+    // to), only those are kept; otherwise the rows the highlights cover.
+    void build(const QVector<HighlightInfo>& highlights, int firstRow = -1, int lastRow = -1);
+    void clear();
+    
+    // Spans touching the given line (empty for lines past the last highlight)
+    SpanRange spansForLine(int line) const;
+    
+    // Compact binary form, as stored by HighlightCache. fromByteArray()
+    // returns false, leaving the index empty, if data is malformed.
+    QByteArray toByteArray() const;
+    bool fromByteArray(const QByteArray& data);
+    
+private:
+    int m_firstLine = 0;        // line the offsets start at
+    QVector<int> m_lineOffsets; // m_spans[m_lineOffsets[n] .. m_lineOffsets[n + 1]) belong to line m_firstLine + n
+    QVector<Span> m_spans;
+};
+}
+#endif // HIGHLIGHTINDEX_HPP
@@ -0,0 +1,98 @@
+#ifndef HIGHLIGHTWORKER_HPP
+#define HIGHLIGHTWORKER_HPP
+
+#include "FileType.hpp"
+#include "code/TreeSitterWrapper.hpp"
+#include "code/HighlightIndex.hpp"
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+
+namespace openide::code
+{
+// Highlights computed for one document revision
+struct HighlightResult
+{
+    int revision = -1;
+    HighlightIndex index;
+    QVector<RowRange> changedRows; // rows to repaint after an incremental parse
+    int firstRow = -1;             // rows the index covers, -1 = the whole text
+    int lastRow = -1;
+    bool fullParse = false;        // parsed from scratch, every row may have changed
+    bool needsText = false;        // edits didn't apply, send the text again via setText()
+};
+
+// Runs tree-sitter parsing and highlight queries on the global thread pool.
+// Text and edits are handed over from the GUI thread tagged with the document
+// revision they produce; edits queued while a parse is running are applied
+// together before the next one, so only the latest revision is parsed.
+class HighlightWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HighlightWorker(QObject* parent = nullptr);
+    ~HighlightWorker();
+    
+    // Replace the text to highlight (drops any queued edits)
+    void setText(const QString& text, openide::FileType fileType, int revision);
+    
+    // Queue an edit, in QString offsets, producing the given revision
+    void addEdit(int position, int charsRemoved, const QString& insertedText, int revision);
+    
+    // Only query highlights for rows [firstRow, lastRow]. Changing the rows
+    // without an edit re-runs the query on the current tree, no re-parse.
+    void setQueryRows(int firstRow, int lastRow);
+    
+    // Once the tree has been parsed at revision, query the whole file and
+    // write the result to HighlightCache under key. Dropped if the text moves
+    // past revision first.
+    void storeFullIndex(const QByteArray& key, int revision);
+    
+signals:
+    // Emitted from a pool thread; connections to GUI objects are queued
+    void highlightsReady(const openide::code::HighlightResult& result);
+    
+private:
+    struct TextEdit
+    {
+        int position;
+        int charsRemoved;
+        QString insertedText;
+    };
+    
+    void scheduleLocked();
+    bool storeReadyLocked() const;
+    // Run a pending storeFullIndex() if the tree is at its revision; unlocks
+    // around the query and the write
+    void storeFullIndexLocked(QMutexLocker<QMutex>& locker);
+    void process();
+    
+    QMutex m_mutex;
+    QWaitCondition m_idle;
+    bool m_running;
+    bool m_stopping;
+    
+    // Pending work, guarded by m_mutex
+    bool m_hasText;
+    QString m_text;
+    openide::FileType m_fileType;
+    QVector<TextEdit> m_edits;
+    int m_revision;
+    bool m_rowsChanged;
+    int m_firstRow;
+    int m_lastRow;
+    QByteArray m_storeKey;
+    int m_storeRevision;
+    int m_treeRevision;  // revision the tree was last parsed at, -1 if none
+    
+    // Only touched by the running task
+    TreeSitterWrapper m_treeWrapper;
+};
+}
+
+Q_DECLARE_METATYPE(openide::code::HighlightResult)
+
+#endif // HIGHLIGHTWORKER_HPP
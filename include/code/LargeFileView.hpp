@@ -0,0 +1,149 @@
+#ifndef LARGEFILEVIEW_HPP
+#define LARGEFILEVIEW_HPP
+
+#include "code/PieceTable.hpp"
+#include "code/FileSaver.hpp"
+
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QTimer>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <memory>
+
+class QProgressBar;
+class QTextLayout;
+
+namespace openide::code
+{
+// Editor for files too large for QTextDocument. The file stays memory mapped
+// behind a PieceTable, and painting only decodes and lays out the lines in
+// view, so opening cost is one scan for line starts and memory use is the
+// line index plus whatever has been typed. Text is treated as UTF-8.
+class LargeFileView : public QAbstractScrollArea
+{
+    Q_OBJECT
+public:
+    explicit LargeFileView(QWidget* parent = nullptr);
+    ~LargeFileView();
+    
+    bool openFile(const QString& path);
+    // Writer for a copy of the current contents, safe to run on another
+    // thread while editing continues
+    FileSaver::Writer snapshotWriter();
+    // Whether a save can run now. On Windows the first edit moves the
+    // mapping to a copy of the file in the background, and until that is
+    // done a save couldn't replace the file; saveReady() follows then.
+    bool requestSave();
+    // Incremented by every edit
+    int revision() const { return m_revision; }
+    
+    bool isModified() const { return m_isModified; }
+    void setModified(bool isModified);
+    void setDarkTheme(bool isDarkTheme);
+    void setTabStopSpaces(int spaces);
+    
+    // The subset of QPlainTextEdit that FindReplaceDialog relies on.
+    // Matches never span lines, as with QTextDocument::find.
+    bool find(const QString& text, QTextDocument::FindFlags flags);
+    void moveCursor(QTextCursor::MoveOperation operation);
+    QString selectedText() const;
+    // Replace the selection (if any) with text at the cursor. Returns false,
+    // changing nothing, while the file is still being indexed or if the
+    // selection touches a line too long to edit.
+    bool insertText(const QString& text);
+    
+signals:
+    void modificationChanged(bool modified);
+    // A save asked for by requestSave() can run now
+    void saveReady();
+    
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void keyPressEvent(QKeyEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    
+private slots:
+    void indexNextChunk();
+    
+private:
+    // A position as seen on screen: column counts QChars of the decoded line
+    struct Position
+    {
+        qint64 line;
+        int column;
+        bool operator==(const Position& other) const { return line == other.line && column == other.column; }
+        bool operator!=(const Position& other) const { return !(*this == other); }
+        bool operator<(const Position& other) const
+        {
+            return line < other.line || (line == other.line && column < other.column);
+        }
+    };
+    
+    // Decoded line without its line ending, clipped to MaxLineBytes
+    QString lineText(qint64 line) const;
+    void layoutLine(QTextLayout& layout, const QString& text) const;
+    qint64 offsetOf(const Position& position) const;
+    Position positionOf(qint64 offset) const;
+    Position positionAt(const QPoint& point) const;
+    
+    // Whether the text from one position to the other can be edited: not
+    // before the index is complete, nor on a line clipped to MaxLineBytes,
+    // whose columns past the clip don't map to the bytes behind them
+    bool canEdit(const Position& from, const Position& to) const;
+    void moveCursorTo(const Position& position, bool keepAnchor);
+    bool hasSelection() const { return m_anchor != m_cursor; }
+    void removeSelection();
+    void removeRange(qint64 from, qint64 to);
+    void ensureCursorVisible();
+    void updateScrollBars();
+    void showProgress(int percent, const QString& format);
+#ifdef Q_OS_WIN
+    // Copy the file on the thread pool and move the mapping to the copy
+    // once done, so a save can replace the file itself
+    void detachFromOriginal();
+    void onDetachFinished(const QString& copyPath, bool copied);
+#endif
+    
+    int lineHeight() const;
+    int visibleRows() const;
+    int gutterWidth() const;
+    int textLeft() const;
+    
+    static constexpr qint64 IndexChunkSize = 32 * 1024 * 1024;
+    static constexpr qint64 SearchChunkSize = 4 * 1024 * 1024;
+    static constexpr qint64 MaxLineBytes = 64 * 1024;
+    static constexpr qint64 CopyChunkSize = 32 * 1024 * 1024;
+    
+    // Shared with in-flight saves, whose snapshots still point into it
+    struct MappedFile
+    {
+        QFile file;
+        uchar* data = nullptr;
+        bool isCopy = false;  // a temporary copy, removed with the mapping
+        ~MappedFile()
+        {
+            if (data) file.unmap(data);
+            if (isCopy) file.remove();
+        }
+    };
+    std::shared_ptr<MappedFile> m_mapping;
+    PieceTable m_buffer;
+    QTimer m_indexTimer;
+    QProgressBar* m_progressBar;
+    
+    Position m_cursor;
+    Position m_anchor;
+    bool m_isModified;
+    bool m_isDetaching;     // the file is being copied, saves wait for it
+    bool m_isSavePending;   // requestSave() was refused while detaching
+    int m_revision;
+    bool m_isDarkTheme;
+    int m_tabStopSpaces;
+    int m_maxLineWidth;
+};
+}
+#endif // LARGEFILEVIEW_HPP
@@ -0,0 +1,102 @@
+#ifndef PIECETABLE_HPP
+#define PIECETABLE_HPP
+
+#include <QByteArray>
+#include <QVector>
+
+class QIODevice;
+
+namespace openide::code
+{
+// Editable byte buffer over a read-only original (usually a memory mapping).
+// Edits only ever append to a separate add buffer; the document is the
+// sequence of pieces referring into either buffer, so opening a file costs
+// nothing beyond indexing where its lines start.
+// Lookups update a cache of where each piece starts, so one table must not be
+// read from several threads at once; hand other threads a copy.
+class PieceTable
+{
+public:
+    PieceTable();
+    
+    // Replace the contents with data, which must outlive the table
+    void setOriginal(const char* data, qint64 size);
+    // Read the original from data from now on, e.g. a copy of it; the bytes
+    // must be the same
+    void moveOriginal(const char* data) { m_original = data; }
+    
+    // Index up to maxBytes more of the original. Returns true once the whole
+    // original is indexed; edits need a complete index.
+    bool indexStep(qint64 maxBytes);
+    bool isIndexed() const { return m_indexedBytes >= m_originalSize; }
+    qint64 indexedBytes() const { return m_indexedBytes; }
+    
+    qint64 size() const { return m_size; }
+    
+    // Lines are separated by '\n'. While indexing, only the lines found so
+    // far are counted.
+    qint64 lineCount() const;
+    qint64 lineStart(qint64 line) const;
+    // Length of a line in bytes, without its '\n'
+    qint64 lineLength(qint64 line) const;
+    // Line containing byte offset pos
+    qint64 lineAt(qint64 pos) const;
+    
+    QByteArray read(qint64 pos, qint64 length) const;
+    void insert(qint64 pos, const QByteArray& bytes);
+    void remove(qint64 pos, qint64 length);
+    
+    // Write the whole document to device
+    bool write(QIODevice* device) const;
+    
+private:
+    struct Piece
+    {
+        bool added;       // refers into m_added rather than the original
+        qint64 start;     // offset in its buffer
+        qint64 length;
+        qint64 newlines;  // '\n' count, so line lookups can skip whole pieces
+    };
+    
+    const char* pieceData(const Piece& piece) const;
+    Piece makePiece(bool added, qint64 start, qint64 length) const;
+    // Split so a piece boundary falls at pos; returns the index of the piece
+    // starting there (m_pieces.size() at the end of the document)
+    int splitAt(qint64 pos);
+    void insertPiece(int index, const Piece& piece);
+    void removePieces(int index, int count);
+    
+    // Piece holding byte pos, or newline n; m_pieces.size() past the end
+    int pieceAt(qint64 pos) const;
+    int pieceAtLine(qint64 n) const;
+    // Bring the first count entries of m_pieceStarts and m_pieceLines up to date
+    void updatePrefix(int count) const;
+    
+    // Newlines in the original before offset, and the offset of newline n
+    qint64 originalRank(qint64 offset) const;
+    qint64 originalSelect(qint64 n) const;
+    
+    // One checkpoint per this many newlines keeps the index small; lookups
+    // scan at most this many lines from the nearest checkpoint
+    static constexpr qint64 CheckpointStride = 256;
+    
+    const char* m_original;
+    qint64 m_originalSize;
+    QByteArray m_added;
+    QVector<Piece> m_pieces;
+    // Document offset and newline count before each piece, valid for the
+    // first m_validPieces. An edit only invalidates the entries after it and
+    // lookups extend them as far as they reach, so a run of edits moving
+    // through the document (Replace All) recomputes them about once.
+    mutable QVector<qint64> m_pieceStarts;
+    mutable QVector<qint64> m_pieceLines;
+    mutable int m_validPieces;
+    qint64 m_size;
+    qint64 m_newlines;
+    
+    QVector<qint64> m_checkpoints;  // offset of every CheckpointStride-th newline
+    qint64 m_indexedBytes;
+    qint64 m_indexedNewlines;
+};
+}
+#endif // PIECETABLE_HPP
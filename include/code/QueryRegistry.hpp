@@ -0,0 +1,77 @@
+#ifndef QUERYREGISTRY_HPP
+#define QUERYREGISTRY_HPP
+
+#include "FileType.hpp"
+#include "code/ColorScheme.hpp"
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+typedef struct TSLanguage TSLanguage;
+typedef struct TSQuery TSQuery;
+
+namespace openide::code
+{
+// A compiled highlight query plus the highlight type of each capture id
+struct CompiledQuery
+{
+    TSQuery* query;
+    QVector<HighlightType> captureTypes;
+    // Hash of the query source and the grammar's shape, so highlights cached
+    // on disk are dropped when either changes
+    QByteArray fingerprint;
+};
+
+// Process-wide store of tree-sitter languages and compiled highlight queries.
+// A TSQuery is immutable once compiled, so every highlighter shares one per
+// language; only the TSQueryCursor that runs it is per call.
+class QueryRegistry
+{
+public:
+    static QueryRegistry& instance();
+    
+    // Get tree-sitter language for file type, nullptr if unsupported
+    static const TSLanguage* language(openide::FileType fileType);
+    
+    // Compiled highlight query for a file type, compiled on first use.
+    // Returns nullptr if the language has no usable query. Safe to call from
+    // any thread; the result stays valid for the life of the process.
+    const CompiledQuery* highlightQuery(openide::FileType fileType);
+    
+    // Start compiling the highlight query for file type on the thread pool,
+    // so it is usually ready by the time the file has been read and parsed
+    void preload(openide::FileType fileType);
+    
+    // Map capture names to highlight types
+    static HighlightType captureNameToHighlightType(const QString& captureName);
+    
+private:
+    QueryRegistry() = default;
+    ~QueryRegistry();
+    QueryRegistry(const QueryRegistry&) = delete;
+    QueryRegistry& operator=(const QueryRegistry&) = delete;
+    
+    // A language's compiled query, resolved at most once under its own lock
+    struct Entry
+    {
+        QMutex mutex;
+        bool resolved = false;
+        CompiledQuery* compiled = nullptr; // nullptr if the query failed
+    };
+    
+    // Find or create the entry for file type
+    Entry* entry(openide::FileType fileType);
+    
+    // Load and compile the highlight query for file type, nullptr on failure
+    static CompiledQuery* compile(openide::FileType fileType);
+    
+    // Read the embedded highlight query source for file type, empty if there
+    // is none
+    static QByteArray loadQuerySource(openide::FileType fileType);
+    
+    QMutex m_mutex; // guards m_entries
+    QHash<openide::FileType, Entry*> m_entries;
+};
+}
+#endif // QUERYREGISTRY_HPP
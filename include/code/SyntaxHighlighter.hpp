@@ -3,10 +3,13 @@
 
 #include "FileType.hpp"
 #include "code/TreeSitterWrapper.hpp"
+#include "code/HighlightIndex.hpp"
+#include "code/HighlightWorker.hpp"
 #include "code/ColorScheme.hpp"
 #include <QSyntaxHighlighter>
 #include <QTextCharFormat>
 #include <QTextDocument>
+#include <QTextCursor>
 #include <QVector>
 
 namespace openide
@@ -19,17 +22,54 @@ public:
     void updateTheme(bool isDarkTheme);
     void highlightBlock(const QString& text) override;
     void rehighlight();
+    
+    // Rows currently on screen; highlights are only queried around them
+    void setVisibleRows(int firstRow, int lastRow);
+    
+    // Show highlights for the whole text, as read back from HighlightCache,
+    // until the worker's own results replace them row range by row range.
+    // Dropped on the next edit.
+    void setCachedHighlights(const openide::code::HighlightIndex& index);
+    // Have the worker write its whole-file highlights for the current text
+    // to HighlightCache under key once it has parsed it
+    void storeInCache(const QByteArray& key);
     ~SyntaxHighlighter();
     
 private:
     void applyHighlights();
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void requestSnapshot();
+    void sendSnapshot();
+    void onHighlightsReady(const openide::code::HighlightResult& result);
+    void rehighlightRows(int firstRow, int lastRow);
+    void updateQueryRows(bool force);
+    void paintCachedRows();
+    void clearCachedHighlights();
+    
+    // Extra rows queried above and below the viewport, so short scrolls
+    // don't need a new query
+    static constexpr int ViewportMarginRows = 200;
+    // Rows repainted from the cached highlights per event loop pass
+    static constexpr int CachedPaintBatchRows = 2000;
     
-    openide::code::TreeSitterWrapper* m_treeWrapper;
+    openide::code::HighlightWorker* m_worker;
     openide::code::ColorScheme* m_colorScheme;
     FileType m_fileType;
     bool m_isDarkTheme;
-    QVector<openide::code::HighlightInfo> m_cachedHighlights;
-    QString m_lastParsedText;
+    openide::code::HighlightIndex m_highlightIndex; // last accepted result, shown until a newer one arrives
+    int m_documentRevision;  // bumped on every contentsChange
+    int m_workerLength;      // text length the worker has after the edits sent so far
+    bool m_snapshotPending;  // full text will be sent on the next event loop turn
+    QVector<QTextCursor> m_editedRanges; // edits and stale changed rows not yet covered by an accepted result
+    int m_visibleFirstRow;
+    int m_visibleLastRow;
+    int m_queryFirstRow;     // rows last requested from the worker
+    int m_queryLastRow;
+    int m_indexFirstRow;     // rows m_highlightIndex covers
+    int m_indexLastRow;
+    openide::code::HighlightIndex m_cachedIndex; // whole-file highlights from disk, for rows outside m_highlightIndex
+    bool m_hasCachedIndex;
+    int m_cachedPaintRow;    // next row to repaint from m_cachedIndex
 };
 }
 #endif // SYNTAXHIGHLIGHTER_HPP
@@ -5,14 +5,13 @@
 #include "code/ColorScheme.hpp"
 #include <QString>
 #include <QVector>
-#include <QMap>
+#include <cstdint>
 
 // Forward declarations for tree-sitter types
 typedef struct TSParser TSParser;
 typedef struct TSTree TSTree;
-typedef struct TSLanguage TSLanguage;
-typedef struct TSQuery TSQuery;
 typedef struct TSQueryCursor TSQueryCursor;
+typedef struct TSPoint TSPoint;
 
 namespace openide::code
 {
@@ -20,36 +19,96 @@ struct HighlightInfo
 {
     int start;
     int length;
+    int startRow;
+    int startColumn;
+    int endRow;
+    int endColumn;
     HighlightType type;
 };
 
+// Inclusive range of rows whose syntax changed in the last re-parse
+struct RowRange
+{
+    int first;
+    int last;
+};
+
 class TreeSitterWrapper
 {
 public:
     TreeSitterWrapper();
     ~TreeSitterWrapper();
     
-    // Parse text and extract highlights
+    // Replace the source text and parse it from scratch
     QVector<HighlightInfo> parseAndHighlight(const QString& text, openide::FileType fileType);
     
+    // Replace the source text without parsing it yet. Returns false if the
+    // language isn't supported.
+    bool setText(const QString& text, openide::FileType fileType);
+    
+    // Parse the source as updated by applyEdit() and extract highlights. The
+    // previous tree is reused so only edited regions are re-lexed.
+    QVector<HighlightInfo> reparseAndHighlight();
+    
+    // Extract highlights from the current tree without re-parsing
+    QVector<HighlightInfo> highlight();
+    
+    // Limit query execution to captures touching rows [firstRow, lastRow].
+    // Pass -1 for both to query the whole tree.
+    void setQueryRows(int firstRow, int lastRow);
+    
+    // Whether there is source text to parse and apply edits to
+    bool hasSource() const { return m_hasSource; }
+    
+    // Rows whose syntax changed in the last incremental parse, as reported by
+    // ts_tree_get_changed_ranges. Empty after a parse from scratch.
+    const QVector<RowRange>& changedRows() const { return m_changedRows; }
+    
+    // Record an edit to the source text. Positions are QString (UTF-16)
+    // offsets, as reported by QTextDocument::contentsChange.
+    // Returns false if the edit doesn't fit the source; the wrapper is reset
+    // in that case and needs setText() before it can parse again.
+    bool applyEdit(int position, int charsRemoved, const QString& insertedText);
+    
+    // Drop the cached tree and source
+    void reset();
+    
     // Check if a language is supported
-    bool isLanguageSupported(openide::FileType fileType) const;
+    static bool isLanguageSupported(openide::FileType fileType);
     
 private:
-    // Get tree-sitter language for file type
-    const TSLanguage* getLanguage(openide::FileType fileType) const;
+    // Extract highlights from parse tree using queries
+    QVector<HighlightInfo> extractHighlights(TSTree* tree, openide::FileType fileType);
     
-    // Get query patterns for file type
-    const char* getQueryPatterns(openide::FileType fileType) const;
+    TSParser* m_parser;
+    TSTree* m_tree;
+    openide::FileType m_treeFileType;
+    // Row of a QString offset in the source, and its tree-sitter point
+    int rowAt(int position) const;
+    TSPoint pointAt(int row, int position) const;
     
-    // Extract highlights from parse tree using queries
-    QVector<HighlightInfo> extractHighlights(const QString& text, TSTree* tree, openide::FileType fileType);
+    // Chunk of the source holding position (the last one at the end)
+    int chunkAt(int position) const;
+    // Replace part of the source, copying only the chunks it touches
+    void replaceSource(int position, int charsRemoved, const QString& insertedText);
+    // TSInput callback handing tree-sitter the rest of the chunk at byteIndex
+    static const char* readSource(void* payload, uint32_t byteIndex, TSPoint position, uint32_t* bytesRead);
     
-    // Map capture names to highlight types
-    HighlightType captureNameToHighlightType(const QString& captureName) const;
+    // The UTF-16 text to parse, kept in sync by applyEdit(). QTextDocument
+    // can't be read off the GUI thread, so the worker keeps its own copy, but
+    // in chunks: an edit splices one chunk instead of moving the whole text.
+    QVector<QString> m_chunks;
+    QVector<int> m_chunkStarts; // offset in the source where each chunk starts
+    int m_sourceSize;
+    QVector<int> m_lineStarts;  // offset in the source where each row starts
+    bool m_hasSource;
+    QVector<RowRange> m_changedRows;
+    int m_queryFirstRow;
+    int m_queryLastRow;
     
-    TSParser* m_parser;
-    QMap<openide::FileType, TSQuery*> m_queries;
+    // Chunks are split at about this many characters, and merged into the
+    // next one once edits shrink them below a quarter of it
+    static constexpr int ChunkChars = 16384;
 };
 }
 #endif // TREESITTERWRAPPER_HPP
@@ -22,11 +22,13 @@ public:
     
 private slots:
     void onFindTriggered();
+    void onFindInFilesTriggered();
     
 private:
     MainWindow* m_mainWindow;
     openide::code::CodeTabPane* m_codeTabPane;
     QAction* m_findAction;
+    QAction* m_findInFilesAction;
 };
 }
 
@@ -5,6 +5,7 @@
 
 #include <QDialog>
 #include <QSpinBox>
+#include <QCheckBox>
 #include <QPushButton>
 #include <QLabel>
 #include <QVBoxLayout>
@@ -43,12 +44,16 @@ private:
     QFontComboBox* m_fontComboBox;
     QSpinBox* m_fontSizeSpinBox;
     QSpinBox* m_tabSpaceSpinBox;
+    QSpinBox* m_largeFileThresholdSpinBox;
     // Project Tree section
     QFontComboBox* m_projectTreeFontComboBox;
     QSpinBox* m_projectTreeFontSizeSpinBox;
     // Terminal section
     QFontComboBox* m_terminalFontComboBox;
     QSpinBox* m_terminalFontSizeSpinBox;
+    QSpinBox* m_terminalScrollbackSpinBox;
+    // Search section
+    QCheckBox* m_searchIndexCheckBox;
     QPushButton* m_okButton;
     QPushButton* m_cancelButton;
     QPushButton* m_applyButton;
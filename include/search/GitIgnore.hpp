@@ -0,0 +1,50 @@
+#ifndef GITIGNORE_HPP
+#define GITIGNORE_HPP
+
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+namespace openide::search
+{
+// The rules of one .gitignore file. Patterns follow git closely enough for
+// searching: '#' comments, '!' negation, a trailing '/' for directories only,
+// a leading or inner '/' anchoring the pattern to the file's directory, and
+// the '*', '?', '[...]' and '**' wildcards.
+class GitIgnore
+{
+public:
+    enum class Match
+    {
+        None,     // no rule applies, ask the enclosing directory's file
+        Ignored,
+        Included  // re-included by a '!' rule
+    };
+    
+    // Read the ignore file at path, whose patterns are relative to baseDir
+    // (relative to the project root, empty for the root itself). Returns
+    // nullptr if the file is missing or has no rules.
+    static std::shared_ptr<const GitIgnore> load(const QString& path, const QString& baseDir);
+    
+    // Match a path relative to the project root. Within one file the last
+    // matching rule wins.
+    Match match(const QString& relativePath, bool isDir) const;
+    
+private:
+    struct Rule
+    {
+        QRegularExpression regex;
+        bool negated;
+        bool directoryOnly;
+    };
+    
+    // Regular expression for one pattern, matched against paths relative to
+    // the ignore file's directory
+    static QString patternToRegex(QStringView pattern, bool anchored);
+    
+    QString m_baseDir; // with a trailing '/', empty for the project root
+    QVector<Rule> m_rules;
+};
+}
+#endif // GITIGNORE_HPP
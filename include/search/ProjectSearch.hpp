@@ -0,0 +1,88 @@
+#ifndef PROJECTSEARCH_HPP
+#define PROJECTSEARCH_HPP
+
+#include "search/TextMatcher.hpp"
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace openide::search
+{
+// Matches in one file
+struct FileMatches
+{
+    QString path;
+    QVector<SearchMatch> matches;
+};
+
+// Searches every file under a project root. One task walks the tree with
+// ProjectWalker and hands out batches of files to the rest of the pool; each
+// file is memory mapped, skipped if it looks binary, and scanned with a
+// TextMatcher. Results are delivered on the GUI thread as each file
+// finishes, so the first ones show up while the walk is still going.
+class ProjectSearch : public QObject
+{
+    Q_OBJECT
+public:
+    // Produces the files to search by passing each path to visit; runs on a
+    // pool thread and should stop early once cancelled is set
+    using FileSource = std::function<void(const std::function<void(const QString& path)>& visit,
+                                          const std::atomic<bool>& cancelled)>;
+    
+    explicit ProjectSearch(QObject* parent = nullptr);
+    // Cancels the search and waits for its tasks
+    ~ProjectSearch();
+    
+    // Search root for pattern, cancelling any search in progress. Returns
+    // false, with errorString() set, if the pattern is unusable.
+    bool start(const QString& root, const QString& pattern, const SearchOptions& options);
+    // Search just the files source produces, e.g. the candidates from a
+    // TrigramIndex; files are searched while the source is still going
+    bool startInFiles(FileSource files, const QString& pattern, const SearchOptions& options);
+    void cancel();
+    bool isRunning() const { return m_run != nullptr; }
+    QString errorString() const { return m_errorString; }
+    
+signals:
+    // Files arrive in no particular order; matches within one are in order
+    void fileMatched(const openide::search::FileMatches& matches);
+    void finished(int filesSearched, int matchCount, bool limitReached);
+    
+private:
+    struct Run;
+    
+    // Cancel the current search and set up a new one; nullptr if the
+    // pattern is unusable
+    std::shared_ptr<Run> createRun(const QString& root, const QString& pattern, const SearchOptions& options);
+    
+    // Pool tasks
+    static void walk(std::shared_ptr<Run> run);
+    static void walkFiles(std::shared_ptr<Run> run, const FileSource& files);
+    static void searchFiles(std::shared_ptr<Run> run, const QStringList& paths);
+    static void searchFile(const std::shared_ptr<Run>& run, const QString& path);
+    // Queue a batch of files for searching
+    static void dispatch(std::shared_ptr<Run> run, QStringList& paths);
+    // Called as each task ends; the last one reports the search finished
+    static void taskDone(const std::shared_ptr<Run>& run);
+    
+    // Files per pool task; enough to amortize scheduling over small files
+    static constexpr int FilesPerTask = 32;
+    // Bytes checked for NULs to tell binary files apart
+    static constexpr qint64 BinaryCheckBytes = 8 * 1024;
+    // Results stop here; more are rarely useful and only slow the panel down
+    static constexpr int MaxMatches = 20000;
+    
+    QThreadPool m_pool;
+    std::shared_ptr<Run> m_run;
+    QString m_errorString;
+};
+}
+
+Q_DECLARE_METATYPE(openide::search::FileMatches)
+
+#endif // PROJECTSEARCH_HPP
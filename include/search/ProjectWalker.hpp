@@ -0,0 +1,36 @@
+#ifndef PROJECTWALKER_HPP
+#define PROJECTWALKER_HPP
+
+#include "search/GitIgnore.hpp"
+#include <QFileInfo>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace openide::search
+{
+// Lists a project's files the way git sees them: .git, symlinked directories
+// and anything matched by a .gitignore or .git/info/exclude are skipped
+class ProjectWalker
+{
+public:
+    // Called with each entry and its path relative to the root
+    using Visitor = std::function<void(const QFileInfo& entry, const QString& relativePath)>;
+    
+    // Walk relativeDir under root (empty for the whole project), calling
+    // onFile for every file and onDirectory, if set, for every directory
+    // entered, relativeDir included. Stops early once cancelled is set.
+    static void walk(const QString& root, const QString& relativeDir, const Visitor& onFile,
+                     const Visitor& onDirectory, const std::atomic<bool>& cancelled);
+    
+private:
+    using Ignores = QVector<std::shared_ptr<const GitIgnore>>;
+    
+    // Ignore files in effect above relativeDir, outermost first
+    static Ignores ignoresAbove(const QString& root, const QString& relativeDir);
+    static bool isIgnored(const Ignores& ignores, const QString& relativePath, bool isDir);
+};
+}
+#endif // PROJECTWALKER_HPP
@@ -0,0 +1,65 @@
+#ifndef SEARCHPANEL_HPP
+#define SEARCHPANEL_HPP
+
+#include "search/ProjectSearch.hpp"
+#include "search/TrigramIndex.hpp"
+
+#include <QWidget>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QCheckBox>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QElapsedTimer>
+
+namespace openide::search
+{
+// Find in files: a pattern box and a tree of results, one node per file with
+// its matching lines below. Results stream in while the search runs.
+class SearchPanel : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit SearchPanel(QWidget* parent = nullptr);
+    ~SearchPanel() = default;
+    
+    // Directory searched, normally the project root
+    void setRootPath(const QString& rootPath);
+    // Keep a TrigramIndex of the project to narrow searches down
+    void setIndexEnabled(bool isEnabled);
+    // Show the panel with the pattern box focused
+    void activate();
+    
+signals:
+    // A result was activated; line is 0-based
+    void matchActivated(const QString& path, int line);
+    
+private slots:
+    void onSearchClicked();
+    void onFileMatched(const openide::search::FileMatches& matches);
+    void onFinished(int filesSearched, int matchCount, bool limitReached);
+    void onItemActivated(QTreeWidgetItem* item, int column);
+    
+private:
+    void setupUI();
+    void setSearching(bool isSearching);
+    
+    ProjectSearch m_search;
+    TrigramIndex m_index;
+    QString m_rootPath;
+    bool m_isIndexEnabled;
+    bool m_usedIndex;        // the running search only scans index candidates
+    QElapsedTimer m_searchTimer;
+    int m_matchCount;
+    
+    QLineEdit* m_patternLineEdit;
+    QCheckBox* m_regexCheckBox;
+    QCheckBox* m_caseSensitiveCheckBox;
+    QCheckBox* m_wholeWordsCheckBox;
+    QPushButton* m_searchButton;
+    QLabel* m_statusLabel;
+    QTreeWidget* m_resultsTree;
+};
+}
+
+#endif // SEARCHPANEL_HPP
@@ -0,0 +1,70 @@
+#ifndef TEXTMATCHER_HPP
+#define TEXTMATCHER_HPP
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+namespace openide::search
+{
+struct SearchOptions
+{
+    bool regex = false;
+    bool caseSensitive = false;
+    bool wholeWords = false;
+};
+
+// One match, located for display
+struct SearchMatch
+{
+    int line;         // 0-based
+    int column;       // within preview, in QChars
+    int length;       // in QChars
+    QString preview;  // the matched line, clipped around the match when long
+};
+
+// Finds a pattern in UTF-8 text. Literal patterns are matched on the raw
+// bytes: memchr (vectorized by the C library) scans for one byte of the
+// pattern and candidates are verified in place, so nothing is decoded but
+// the lines that match. Regular expressions, and case-insensitive patterns
+// with non-ASCII letters, fall back to QRegularExpression over the decoded
+// text. Immutable once constructed, so one matcher serves every thread.
+class TextMatcher
+{
+public:
+    TextMatcher(const QString& pattern, const SearchOptions& options);
+    
+    bool isValid() const { return m_isValid; }
+    QString errorString() const { return m_errorString; }
+    
+    // Matches in data, in order, stopping after maxMatches
+    QVector<SearchMatch> search(const char* data, qint64 size, int maxMatches) const;
+    
+private:
+    QVector<SearchMatch> searchLiteral(const char* data, qint64 size, int maxMatches) const;
+    QVector<SearchMatch> searchRegex(const char* data, qint64 size, int maxMatches) const;
+    bool matchesAt(const char* candidate) const;
+    static bool isWordByte(char c);
+    // Match at byte offset start of length bytes, on the line that starts at
+    // lineStart
+    static SearchMatch locate(const char* data, qint64 size, int line, qint64 lineStart,
+                              qint64 start, qint64 length);
+    
+    // Longest preview; longer lines are clipped around the match
+    static constexpr qint64 MaxPreviewBytes = 400;
+    static constexpr qint64 PreviewContextBytes = 100;
+    
+    bool m_isValid;
+    QString m_errorString;
+    bool m_useRegex;
+    bool m_caseSensitive;
+    bool m_wholeWords;
+    QByteArray m_needle;     // UTF-8, ASCII-lowercased when case-insensitive
+    int m_anchorIndex;       // byte of m_needle that memchr looks for
+    char m_anchor;
+    char m_anchorAlt;        // other case of m_anchor, or m_anchor itself
+    QRegularExpression m_regex;
+};
+}
+#endif // TEXTMATCHER_HPP
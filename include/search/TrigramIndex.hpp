@@ -0,0 +1,109 @@
+#ifndef TRIGRAMINDEX_HPP
+#define TRIGRAMINDEX_HPP
+
+#include "search/ProjectSearch.hpp"
+#include "search/TextMatcher.hpp"
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+namespace openide::search
+{
+// On-disk trigram index of a project, used to narrow a search down to the
+// files that can possibly match. Each file is reduced to the set of 3-byte
+// sequences in it (ASCII case-folded). The literals a query requires give
+// trigrams every matching file must contain, and intersecting their posting
+// lists leaves the candidates.
+//
+// The index is saved per project in the config directory and memory mapped
+// when the project opens. A background pass re-stats the tree and reindexes
+// whatever changed, and a QFileSystemWatcher keeps it current after that.
+// Changes are held in memory on top of the mapped file until there are
+// enough of them to be worth writing a new one.
+class TrigramIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TrigramIndex(QObject* parent = nullptr);
+    // Abandons any pass in progress and waits for it
+    ~TrigramIndex();
+    
+    // Index the project at root; an empty root closes the index
+    void open(const QString& root);
+    // Whether the index is up to date with the project, as far as the file
+    // watcher knows. Never true once the project has more directories than
+    // can be watched, since files added to the rest would go unnoticed.
+    bool isReady() const { return m_isReady && !m_isUpdating && m_pendingDirs.isEmpty(); }
+    
+    // Source of the absolute paths of the files that may match, including
+    // any indexed file modified since it was indexed. It reads a snapshot of
+    // the index, so the search runs it on its own pool rather than the GUI
+    // thread. nullptr if the index isn't ready or the query has no trigrams
+    // to narrow by.
+    ProjectSearch::FileSource candidates(const QString& pattern, const SearchOptions& options) const;
+    
+    // Index file for the project at root
+    static QString getIndexFilePath(const QString& root);
+    
+signals:
+    // The first pass after open() finished, or the index was closed
+    void readyChanged(bool isReady);
+    
+private:
+    struct Snapshot;
+    
+    void onDirectoryChanged(const QString& path);
+    void startUpdate();
+    void onUpdateFinished(int generation, std::shared_ptr<const Snapshot> snapshot,
+                          const QStringList& directories);
+    void setReady(bool isReady);
+    
+    // Bring current up to date for the files under dirs (relative to root)
+    // and return the result; nullptr if cancelled. Runs on m_pool.
+    static std::shared_ptr<const Snapshot> update(const QString& root, std::shared_ptr<const Snapshot> current,
+                                                  const QStringList& dirs, QStringList& directories,
+                                                  const std::atomic<bool>& cancelled);
+    // Write snapshot out as a new index file and map it; nullptr on failure
+    static std::shared_ptr<const Snapshot> compact(const QString& root, const Snapshot& snapshot);
+    
+    // Pass the files of snapshot that may contain all of trigrams to visit
+    static void findCandidates(const QString& root, const Snapshot& snapshot, const QVector<quint32>& trigrams,
+                               const std::function<void(const QString&)>& visit,
+                               const std::atomic<bool>& cancelled);
+    // Sorted trigrams every match of the query contains
+    static QVector<quint32> queryTrigrams(const QString& pattern, const SearchOptions& options);
+    // Literal runs of at least three characters that every match of a
+    // regular expression contains; empty if none can be found safely
+    static QStringList requiredLiterals(const QString& regex);
+    static bool isUnder(const QString& path, const QString& dir);
+    // Whether the file at path differs from when it was indexed
+    static bool isModified(const QString& path, qint64 modified, qint64 size);
+    
+    // Changes are picked up once the tree has been quiet this long
+    static constexpr int UpdateDelayMs = 500;
+    // Inotify allows 8192 watches per user by default
+    static constexpr int MaxWatchedDirectories = 8000;
+    // In-memory changes that trigger writing a new index file
+    static constexpr int CompactThreshold = 256;
+    
+    QString m_root;
+    std::shared_ptr<const Snapshot> m_snapshot;
+    bool m_isReady;
+    bool m_isUpdating;
+    bool m_isWatchLimitReached;       // some directories couldn't be watched
+    int m_generation;                 // bumped by open(), so stale passes are ignored
+    QSet<QString> m_pendingDirs;      // changed since the last pass started, relative to m_root
+    QFileSystemWatcher m_watcher;
+    QTimer m_updateTimer;
+    QThreadPool m_pool;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+}
+#endif // TRIGRAMINDEX_HPP
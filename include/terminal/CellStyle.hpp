@@ -0,0 +1,50 @@
+#ifndef CELLSTYLE_HPP
+#define CELLSTYLE_HPP
+
+#include <QColor>
+#include <QtGlobal>
+
+namespace openide::terminal
+{
+// How a run of terminal text is drawn, as set by SGR sequences (ESC [ ... m).
+// Colors are kept as the program chose them (default, one of 256 indexed,
+// or direct RGB) and only resolved against the theme when painting.
+struct CellStyle
+{
+    enum Attribute : quint8
+    {
+        Bold = 0x01,
+        Dim = 0x02,
+        Italic = 0x04,
+        Underline = 0x08,
+        Inverse = 0x10,
+        Strikeout = 0x20
+    };
+    
+    // Color encoding: the top byte says which kind, the rest is the value
+    static constexpr quint32 DefaultColor = 0;
+    static constexpr quint32 IndexedColor = 0x01000000;
+    static constexpr quint32 RgbColor = 0x02000000;
+    
+    quint32 foreground = DefaultColor;
+    quint32 background = DefaultColor;
+    quint8 attributes = 0;
+    
+    bool operator==(const CellStyle& other) const
+    {
+        return foreground == other.foreground && background == other.background && attributes == other.attributes;
+    }
+    bool operator!=(const CellStyle& other) const { return !(*this == other); }
+    bool isDefault() const { return *this == CellStyle(); }
+    bool has(Attribute attribute) const { return (attributes & attribute) != 0; }
+    
+    // Apply the parameters of one SGR sequence; -1 stands for a missing one
+    void applySgr(const int* params, int count);
+    
+    // Resolve an encoded color, fallback standing in for DefaultColor
+    static QColor color(quint32 encoded, const QColor& fallback);
+    // The xterm 256-color palette
+    static QColor indexedColor(int index);
+};
+}
+#endif // CELLSTYLE_HPP
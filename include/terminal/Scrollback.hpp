@@ -0,0 +1,69 @@
+#ifndef SCROLLBACK_HPP
+#define SCROLLBACK_HPP
+
+#include "terminal/CellStyle.hpp"
+#include <QString>
+#include <QVector>
+
+namespace openide::terminal
+{
+// Terminal output as a ring of styled lines. Once the limit is reached each
+// new line reuses the oldest one's slot, so appending is O(1), memory is
+// bounded, and any line is found by index without scanning the rest.
+// Writing only ever touches the last line, where the terminal's cursor is.
+class Scrollback
+{
+public:
+    // Style changes within a line: each span runs until the next one starts,
+    // and text before the first has the default style
+    struct StyleSpan
+    {
+        int start;
+        CellStyle style;
+    };
+    struct Line
+    {
+        QString text;
+        QVector<StyleSpan> spans;
+    };
+    
+    explicit Scrollback(int capacity = 10000);
+    
+    int capacity() const { return m_capacity; }
+    // Keep at most capacity lines, dropping the oldest beyond that
+    void setCapacity(int capacity);
+    
+    // Lines held, at least one: the last is the one being written
+    int lineCount() const { return m_count; }
+    const Line& line(int index) const { return m_lines[slot(index)]; }
+    const Line& lastLine() const { return line(m_count - 1); }
+    bool isEmpty() const { return m_count == 1 && lastLine().text.isEmpty(); }
+    
+    // Start a new last line. Returns true if that dropped the oldest line.
+    bool newLine();
+    void clear();
+    
+    // Edits to the last line. Columns count QChars; writing past the end
+    // fills the gap with unstyled blanks.
+    void write(int column, const QChar* text, qsizetype length, const CellStyle& style);
+    // Drop everything from column on
+    void truncate(int column);
+    void remove(int column, int count);
+    // Give the text of the last line that has the default foreground this one
+    void setDefaultForeground(quint32 foreground);
+    
+private:
+    int slot(int index) const { return (m_first + index) % m_lines.size(); }
+    Line& last() { return m_lines[slot(m_count - 1)]; }
+    
+    // Give text in [from, to) of line style
+    static void applyStyle(Line& line, int from, int to, const CellStyle& style);
+    static CellStyle styleAt(const Line& line, int column);
+    
+    QVector<Line> m_lines;  // grows to m_capacity, then wraps around
+    int m_first;            // slot of the oldest line
+    int m_count;
+    int m_capacity;
+};
+}
+#endif // SCROLLBACK_HPP
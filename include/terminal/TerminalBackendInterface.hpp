@@ -1,34 +1,72 @@
 #ifndef TERMINALBACKENDINTERFACE_HPP
 #define TERMINALBACKENDINTERFACE_HPP
 
+#include <QObject>
 #include <QString>
+#include <QByteArray>
 #include <QProcess>
+#include <QStringDecoder>
 
 namespace openide::terminal
 {
-struct TerminalBackendInterface
+struct TerminalBackendInterface : public QObject
 {
+    Q_OBJECT
 public:
     TerminalBackendInterface();
     virtual ~TerminalBackendInterface() = default;
     
     virtual void init() = 0;
     virtual void close();
-    virtual QString executeCommand(const QString& command, const QString& workingDirectory = QString()) = 0;
+    // Start command without waiting for it. Its output arrives through
+    // outputReceived and its end through commandFinished, or
+    // commandCancelled after interrupt. Returns false if the backend isn't
+    // initialized or another command is still running.
+    virtual bool startCommand(const QString& command, const QString& workingDirectory = QString()) = 0;
+    bool isCommandRunning() const { return m_process != nullptr; }
+    // Cancel the running command, or interrupt the session's foreground job
+    virtual void interrupt();
     
-protected:
-    // Common output cleaning function - removes ANSI escape sequences and normalizes output
-    static QString cleanTerminalOutput(const QString& output);
+    // Whether a long-lived shell is running. Input then goes to it through
+    // writeInput and everything it prints arrives through outputReceived;
+    // startCommand is only used without one.
+    virtual bool hasSession() const { return false; }
+    // Send bytes to the session, or to the running command, as if typed
+    virtual void writeInput(const QByteArray& data);
+    // Size of the session's terminal in character cells
+    virtual void setTerminalSize(int columns, int rows);
+    
+signals:
+    // UTF-8 output of the session or the running command, as it arrives
+    void outputReceived(const QByteArray& data);
+    void commandFinished(int exitCode);
+    void commandCancelled();
+    // The session's shell exited
+    void sessionFinished(int exitCode);
     
-    // Platform-specific output cleaning - can be overridden by derived classes
+protected:
+    // Platform-specific cleaning of each chunk of command output - can be
+    // overridden by derived classes
     virtual QString platformSpecificCleanOutput(const QString& output);
     
-    // Common helper to execute a process and return output
-    QString executeProcess(const QString& program, const QStringList& arguments, const QString& workingDirectory);
+    // Common helper to start a process whose output and exit are reported
+    // through the signals above
+    bool startProcess(const QString& program, const QStringList& arguments, const QString& workingDirectory);
     
     // Common members
     bool m_isInitialized;
     QString m_workingDirectory;
+    
+private:
+    void forwardProcessOutput(QProcess* process);
+    void finishProcess(QProcess* process, int exitCode);
+    
+    // Time a cancelled command gets to exit before it is killed
+    static constexpr int CancelGraceMs = 2000;
+    
+    QProcess* m_process;  // the running command, nullptr if none
+    QStringDecoder m_processDecoder;
+    bool m_isCancelling;
 };
 }
 #endif // TERMINALBACKENDINTERFACE_HPP
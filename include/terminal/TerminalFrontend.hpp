@@ -9,15 +9,25 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QWidget>
+#include <QByteArray>
+#include <QColor>
+#include <QFont>
+#include <QCache>
+#include <QStaticText>
+#include <QTimer>
+#include "terminal/VtParser.hpp"
+#include "terminal/CellStyle.hpp"
+#include "terminal/Scrollback.hpp"
 
 // forward decl
 class MainWindow;
+class QPainter;
 
 namespace openide::terminal
 {
 struct TerminalBackendInterface;
 
-class TerminalFrontend : public QAbstractScrollArea
+class TerminalFrontend : public QAbstractScrollArea, private VtParser::Handler
 {
 Q_OBJECT
 public:
@@ -29,6 +39,8 @@ public:
     void updateFontSize(int size);
     bool isCollapsed() const { return m_isCollapsed; }
     void forceOpen(); // Force terminal to be visible and expanded
+    // Keep at most this many lines of output, dropping the oldest first
+    void setScrollbackLimit(int lines);
     
 public slots:
     void toggleCollapse();
@@ -40,22 +52,74 @@ protected:
     void resizeEvent(QResizeEvent* event) override;
     void wheelEvent(QWheelEvent* event) override;
     bool eventFilter(QObject* obj, QEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
     
 private slots:
     void onCommandEntered();
+    void onOutputReceived(const QByteArray& data);
+    void onCommandFinished(int exitCode);
+    void onCommandCancelled();
+    void onSessionFinished(int exitCode);
+    // Scroll to and draw whatever changed since the last frame
+    void repaintOutput();
     
 private:
     void executeUserCommand(const QString& command);
+    // Append plain text of our own, such as messages and echoed commands
     void appendOutput(const QString& text);
+    // Schedule a repaint after output changed; bursts share one per frame
+    void outputChanged();
+    // Mark line as needing a repaint
+    void damageLine(int line);
+    // Forget stream state left over from a command or session that ended
+    void resetOutputStream();
+    // Start a line for whatever comes next unless output already ends one
+    void ensureNewline();
+    void clearOutput();
+    // Show our own prompt only when there is no shell to print one
+    void updateSessionMode();
+    // Tell the backend how many character cells fit in the viewport
+    void updateTerminalSize();
     QString getCurrentDirectory() const;
     void updatePrompt();
     
     void updateHeaderButtons();
     
+    // Rebuild the fonts and cell size after the font size changed
+    void updateFontMetrics();
+    void updateScrollRange();
+    // Part of the viewport between the header bar and the input line
+    QRect outputRect() const;
+    // Viewport y of the top of line's row
+    int lineTop(int line) const;
+    
+    // VtParser::Handler: the stream is kept as lines of styled text with a
+    // cursor on the last one; sequences that address other rows are ignored
+    void print(const QChar* text, qsizetype length) override;
+    void execute(char control) override;
+    void csiDispatch(char prefix, const int* params, int count, char intermediate, char final) override;
+    void newLine();
+    void eraseInLine(int mode);
+    // Color a finished line of plain output that reports an error or warning
+    void highlightDiagnostic();
+    // Draw one line of output in the row at top, one run per style
+    void drawStyledLine(QPainter& painter, qreal x, int top, const Scrollback::Line& line,
+                        const QColor& defaultColor);
+    // Text laid out in a font variant, cached between paints
+    const QStaticText& staticText(const QString& text, int variant);
+    static int fontVariant(const CellStyle& style);
+    
     MainWindow* m_mainWindow;
     TerminalBackendInterface* m_backend;
-    QString m_output;
+    Scrollback m_scrollback;
     QString m_currentDirectory;
+    
+    VtParser m_parser;
+    CellStyle m_style;         // style for text printed next
+    int m_cursorColumn;        // in QChars on the last line, may be past its end
+    QColor m_backgroundColor;
+    bool m_isSessionEnded;  // restart the shell with the next command
+    
     QLineEdit* m_inputLine;
     QWidget* m_inputContainer;
     QLabel* m_promptLabel;
@@ -65,6 +129,21 @@ private:
     bool m_isCollapsed;
     int m_originalHeight;
     int m_fontSize;
+    
+    // Output is drawn on a grid of equal cells, one per QChar. Each
+    // combination of bold, italic, underline and strikeout has its own font.
+    static constexpr int FontVariants = 16;
+    static constexpr int TextCacheSize = 1024;
+    static constexpr int FrameIntervalMs = 16;
+    QFont m_fonts[FontVariants];
+    QCache<QString, QStaticText> m_textCaches[FontVariants];
+    qreal m_cellWidth;
+    int m_lineHeight;
+    int m_descent;
+    
+    QTimer m_repaintTimer;
+    int m_firstDamagedLine;  // first line changed since the last repaint, -1 if none
+    int m_droppedLines;      // lines dropped from the top since the last repaint
 };
 } // namespace openide::terminal
 #endif
@@ -5,9 +5,17 @@
 #include "TerminalBackendInterface.hpp"
 #include <QString>
 #include <QProcess>
+#include <QByteArray>
+#include <sys/types.h>
+
+class QSocketNotifier;
 
 namespace openide::terminal
 {
+// Runs one shell for the life of the terminal on a pseudo-terminal, so
+// commands keep their environment, aliases and working directory, output
+// streams as it is written and interactive programs see a real tty. Falls
+// back to a shell per command if no pseudo-terminal can be opened.
 struct UnixTerminalBackend : public TerminalBackendInterface
 {
     UnixTerminalBackend();
@@ -15,12 +23,39 @@ struct UnixTerminalBackend : public TerminalBackendInterface
     
     void init() override;
     void close() override;
-    QString executeCommand(const QString& command, const QString& workingDirectory = QString()) override;
+    bool startCommand(const QString& command, const QString& workingDirectory = QString()) override;
+    void interrupt() override;
+    
+    bool hasSession() const override { return m_shellPid > 0; }
+    void writeInput(const QByteArray& data) override;
+    void setTerminalSize(int columns, int rows) override;
     
 private:
     QString findShell();
-    QProcess* m_process;
+    
+    // Fork the shell onto a new pseudo-terminal; false if that failed
+    bool startSession();
+    // Drain the pseudo-terminal, ending the session once the shell is gone
+    void readOutput();
+    // Write as much pending input as the pseudo-terminal takes
+    void flushInput();
+    void endSession();
+    // Wait for the shell to exit, killing it if it doesn't, and return its
+    // exit code
+    int reapShell(bool isHangingUp);
+    
+    // Cap on bytes read per notification, so a flood of output can't keep
+    // the event loop from painting
+    static constexpr qint64 MaxReadPerNotification = 1024 * 1024;
+    
     QString m_shellPath;
+    pid_t m_shellPid;
+    int m_masterFd;
+    QSocketNotifier* m_readNotifier;
+    QSocketNotifier* m_writeNotifier;
+    QByteArray m_pendingInput;
+    int m_columns;
+    int m_rows;
 };
 }
 #endif // !WIN32
@@ -0,0 +1,98 @@
+#ifndef VTPARSER_HPP
+#define VTPARSER_HPP
+
+#include <QByteArray>
+#include <QChar>
+#include <QtGlobal>
+
+namespace openide::terminal
+{
+// Incremental parser for the byte stream a terminal receives: UTF-8 text
+// mixed with VT100/xterm control functions. It follows the state machine of
+// the DEC ANSI parser, so input may be split anywhere across feed() calls,
+// in the middle of a sequence or a character, and every byte is looked at
+// once. What it recognizes goes to a Handler.
+class VtParser
+{
+public:
+    class Handler
+    {
+    public:
+        virtual ~Handler() = default;
+        // A run of printable text, valid only during the call
+        virtual void print(const QChar* text, qsizetype length) = 0;
+        // A C0 control such as '\n', '\r', '\b', '\t' or BEL
+        virtual void execute(char control) = 0;
+        // ESC [ prefix params intermediate final. prefix is a private marker
+        // such as '?' or 0, missing parameters are -1 and intermediate is the
+        // last intermediate byte or 0.
+        virtual void csiDispatch(char prefix, const int* params, int count, char intermediate, char final) = 0;
+        // ESC intermediate final, other than the introducers handled here
+        virtual void escDispatch(char intermediate, char final)
+        {
+            Q_UNUSED(intermediate);
+            Q_UNUSED(final);
+        }
+        // ESC ] data BEL, e.g. a window title
+        virtual void oscDispatch(const QByteArray& data) { Q_UNUSED(data); }
+    };
+    
+    explicit VtParser(Handler* handler);
+    
+    void feed(const char* data, qsizetype size);
+    void feed(const QByteArray& data) { feed(data.constData(), data.size()); }
+    // Forget any partial sequence or character
+    void reset();
+    
+private:
+    enum class State
+    {
+        Ground,
+        Escape,
+        EscapeIntermediate,
+        CsiEntry,
+        CsiParam,
+        CsiIntermediate,
+        CsiIgnore,
+        OscString,
+        IgnoreString  // DCS, SOS, PM and APC, which nothing here uses
+    };
+    
+    void handleControl(uchar byte);
+    void handleEscape(uchar byte);
+    void handleCsi(uchar byte);
+    void handleString(uchar byte);
+    void clearSequence();
+    void dispatchCsi(uchar final);
+    
+    // Text decoding, with printable text buffered until something else comes
+    void decodeText(uchar byte);
+    void appendCodePoint(char32_t codePoint);
+    void flushText();
+    
+    static constexpr int MaxParams = 16;
+    static constexpr qsizetype TextBufferSize = 4096;
+    // OSC strings past this are cut, a title doesn't need more
+    static constexpr qsizetype MaxOscLength = 4096;
+    
+    Handler* m_handler;
+    State m_state;
+    
+    // The sequence being parsed
+    int m_params[MaxParams];
+    int m_paramCount;
+    char m_prefix;
+    char m_intermediate;
+    QByteArray m_oscData;
+    bool m_stringEscape;  // ESC seen in a string, possibly starting ST
+    
+    // The UTF-8 character being decoded
+    char32_t m_codePoint;
+    int m_pendingBytes;
+    char32_t m_minimumCodePoint;  // rejects overlong encodings
+    
+    QChar m_text[TextBufferSize];
+    qsizetype m_textLength;
+};
+}
+#endif // VTPARSER_HPP
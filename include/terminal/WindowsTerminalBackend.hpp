@@ -15,13 +15,10 @@ struct WindowsTerminalBackend : public TerminalBackendInterface
     
     void init() override;
     void close() override;
-    QString executeCommand(const QString& command, const QString& workingDirectory = QString()) override;
+    bool startCommand(const QString& command, const QString& workingDirectory = QString()) override;
     
 protected:
     QString platformSpecificCleanOutput(const QString& output) override;
-    
-private:
-    QProcess* m_process;
 };
 }
 #endif // WIN32
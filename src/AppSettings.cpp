@@ -16,6 +16,9 @@ AppSettings::AppSettings()
     , m_projectTreeFontSize(10)
     , m_terminalFontFamily("")
     , m_terminalFontSize(10)
+    , m_terminalScrollbackLines(10000)
+    , m_largeFileThresholdMB(64)
+    , m_searchIndexEnabled(true)
 {
     setDefaults();
 }
@@ -46,6 +49,12 @@ void AppSettings::setDefaults()
     if (m_terminalFontSize <= 0) {
         m_terminalFontSize = 10;
     }
+    if (m_terminalScrollbackLines <= 0) {
+        m_terminalScrollbackLines = 10000;
+    }
+    if (m_largeFileThresholdMB <= 0) {
+        m_largeFileThresholdMB = 64;
+    }
 }
 
 QFont AppSettings::font() const
@@ -97,6 +106,23 @@ void AppSettings::setTerminalFontSize(int size)
     setDefaults(); // Ensure valid size
 }
 
+void AppSettings::setTerminalScrollbackLines(int lines)
+{
+    m_terminalScrollbackLines = lines;
+    setDefaults(); // Ensure valid limit
+}
+
+void AppSettings::setLargeFileThresholdMB(int megabytes)
+{
+    m_largeFileThresholdMB = megabytes;
+    setDefaults(); // Ensure valid threshold
+}
+
+void AppSettings::setSearchIndexEnabled(bool isEnabled)
+{
+    m_searchIndexEnabled = isEnabled;
+}
+
 QString AppSettings::getConfigDirectory()
 {
     QString homeDir = QDir::homePath();
@@ -174,6 +200,18 @@ bool AppSettings::loadFromFile()
         m_terminalFontSize = obj["terminalFontSize"].toInt();
     }
     
+    if (obj.contains("terminalScrollbackLines") && obj["terminalScrollbackLines"].isDouble()) {
+        m_terminalScrollbackLines = obj["terminalScrollbackLines"].toInt();
+    }
+    
+    if (obj.contains("largeFileThresholdMB") && obj["largeFileThresholdMB"].isDouble()) {
+        m_largeFileThresholdMB = obj["largeFileThresholdMB"].toInt();
+    }
+    
+    if (obj.contains("searchIndexEnabled") && obj["searchIndexEnabled"].isBool()) {
+        m_searchIndexEnabled = obj["searchIndexEnabled"].toBool();
+    }
+    
     setDefaults(); // Ensure all values are valid
     return true;
 }
@@ -195,6 +233,9 @@ bool AppSettings::saveToFile() const
     obj["projectTreeFontSize"] = m_projectTreeFontSize;
     obj["terminalFontFamily"] = m_terminalFontFamily;
     obj["terminalFontSize"] = m_terminalFontSize;
+    obj["terminalScrollbackLines"] = m_terminalScrollbackLines;
+    obj["largeFileThresholdMB"] = m_largeFileThresholdMB;
+    obj["searchIndexEnabled"] = m_searchIndexEnabled;
     
     QJsonDocument doc(obj);
     QTextStream out(&file);
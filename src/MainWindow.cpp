@@ -4,6 +4,7 @@
 #include "menu/ThemeMenu.hpp"
 #include "menu/SettingsMenu.hpp"
 #include "AppSettings.hpp"
+#include "Session.hpp"
 #include "ui/StyleUtils.hpp"
 #include "terminal/TerminalBackendInterface.hpp"
 #ifdef WIN32
@@ -12,6 +13,8 @@
 #include "terminal/UnixTerminalBackend.hpp"
 #endif
 #include <QApplication>
+#include <QCloseEvent>
+#include <QMessageBox>
 
 using namespace openide;
 using namespace openide::terminal;
@@ -26,6 +29,7 @@ MainWindow::MainWindow(QWidget *parent)
     , m_toggleTreeAction(nullptr)
     , m_projectTree(this)
     , m_codeTabPane(this)
+    , m_searchPanel(this)
     , m_fileMenu(this, this->menuBar(), &m_projectTree, &m_codeTabPane)
     , m_editMenu(this, this->menuBar(), &m_codeTabPane)
     , m_themeMenu(this, this->menuBar())
@@ -36,6 +40,8 @@ MainWindow::MainWindow(QWidget *parent)
 {
     // Load settings on startup
     m_appSettings.loadFromFile();
+    m_searchPanel.setIndexEnabled(m_appSettings.searchIndexEnabled());
+    m_terminalFrontend.setScrollbackLimit(m_appSettings.terminalScrollbackLines());
     
     // Create OS-specific terminal backend
 #ifdef WIN32
@@ -61,17 +67,19 @@ MainWindow::MainWindow(QWidget *parent)
     m_toggleTreeAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_B));
     connect(m_toggleTreeAction, &QAction::triggered, this, &MainWindow::toggleProjectTree);
 
-    // Vertical splitter for the CodeTabPane and TerminalFrontend
+    // Vertical splitter for the CodeTabPane, find in files and TerminalFrontend
     m_verticalSplitter->addWidget(&m_codeTabPane);
+    m_verticalSplitter->addWidget(&m_searchPanel);
     m_verticalSplitter->addWidget(&m_terminalFrontend);
-    m_verticalSplitter->setSizes({550, 250});
+    m_verticalSplitter->setSizes({550, 250, 250});
     m_verticalSplitter->setOpaqueResize(false);
     m_verticalSplitter->setHandleWidth(3);
     // Set initial style (will be updated when theme is applied)
     m_verticalSplitter->setStyleSheet(openide::ui::StyleUtils::getSplitterHandleStyle(true));
     
-    // Hide terminal by default
+    // Hide terminal and search results by default
     m_terminalFrontend.setVisible(false);
+    m_searchPanel.setVisible(false);
     
     // Horizontal splitter for ProjectTree and "Code Area"
     m_horizontalSplitter->addWidget(&m_projectTree);
@@ -106,11 +114,18 @@ MainWindow::MainWindow(QWidget *parent)
         m_projectTree.updateFontSize(m_appSettings.projectTreeFontSize());
         // Update terminal font size (font family is handled via settings, but we only expose size control)
         m_terminalFrontend.updateFontSize(m_appSettings.terminalFontSize());
+        m_terminalFrontend.setScrollbackLimit(m_appSettings.terminalScrollbackLines());
+        m_searchPanel.setIndexEnabled(m_appSettings.searchIndexEnabled());
     });
     
     // Connect project opened signal to update title
     connect(&m_fileMenu, &openide::menu::FileMenu::projectOpened, this, &MainWindow::onProjectOpened);
     
+    // Open search results at the matching line
+    connect(&m_searchPanel, &openide::search::SearchPanel::matchActivated, this, [this](const QString& path, int line){
+        m_codeTabPane.openFile(path, line);
+    });
+    
     // Update Edit menu state when tabs change
     connect(&m_codeTabPane, &openide::code::CodeTabPane::editMenuStateChanged, this, [this](){
         m_editMenu.updateFindActionState();
@@ -124,8 +139,42 @@ void MainWindow::onProjectOpened(const QString& projectPath, const QString& proj
 {
     // Normalize the path to ensure it's stored correctly
     QDir dir(projectPath);
-    m_currentProjectRoot = dir.absolutePath();
+    const QString projectRoot = dir.absolutePath();
+    const QJsonObject session = Session::load(projectRoot);
+    
+    // Restoring the session closes the open tabs; decide before anything is
+    // switched or saved, so staying keeps this project whole
+    if (openide::code::CodeTabPane::isValidSession(session) && m_codeTabPane.hasUnsavedChanges()) {
+        QMessageBox::StandardButton choice = QMessageBox::question(this, "Open Project",
+            "Opening this project closes the open tabs, and some have unsaved changes. Discard them?",
+            QMessageBox::Discard | QMessageBox::Cancel, QMessageBox::Cancel);
+        if (choice != QMessageBox::Discard) {
+            if (!m_currentProjectRoot.isEmpty()) {
+                m_projectTree.loadTreeFromDir(&m_currentProjectRoot);
+            }
+            return;
+        }
+    }
+    
+    // Keep the previous project's tabs for when it is opened again
+    if (!m_currentProjectRoot.isEmpty()) {
+        Session::save(m_currentProjectRoot, m_codeTabPane.saveSession());
+    }
+    
+    m_currentProjectRoot = projectRoot;
     setProjectTitle(projectName);
+    m_searchPanel.setRootPath(m_currentProjectRoot);
+    
+    // Bring back this project's layout; its tabs load as they are shown
+    m_codeTabPane.restoreSession(session);
+}
+
+void MainWindow::closeEvent(QCloseEvent* event)
+{
+    if (!m_currentProjectRoot.isEmpty()) {
+        Session::save(m_currentProjectRoot, m_codeTabPane.saveSession());
+    }
+    QMainWindow::closeEvent(event);
 }
 
 void MainWindow::setProjectTitle(const QString& projectName)
@@ -172,6 +221,11 @@ void MainWindow::updateSplitterStyles(bool isDarkTheme)
     }
 }
 
+void MainWindow::showSearchPanel()
+{
+    m_searchPanel.activate();
+}
+
 void MainWindow::toggleProjectTree()
 {
     bool isVisible = m_projectTree.isVisible();
@@ -98,7 +98,8 @@ void ProjectTree::onItemDoubleClicked(const QModelIndex& index)
     code::CodeTabPane* codeTabPane = m_parent->getCodeTabPane();
     if (codeTabPane && !codeTabPane->fileIsOpen(path)) {
         code::CodeEditor* newEditor = new code::CodeEditor(m_parent, m_parent->getAppSettings());
-        newEditor->loadFile(path, fileType);
+        // Read when the tab is first shown
+        newEditor->setFile(path, fileType);
         codeTabPane->addTab(newEditor, fileName);
     }
 }
@@ -0,0 +1,70 @@
+#include "Session.hpp"
+#include "AppSettings.hpp"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
+
+using namespace openide;
+
+namespace
+{
+// Bytes read per call while prefetching
+const qint64 PrefetchBlockSize = 1024 * 1024;
+}
+
+QString Session::getSessionFilePath(const QString& projectRoot)
+{
+    QDir dir(AppSettings::getConfigDirectory());
+    if (!dir.exists("sessions")) {
+        dir.mkpath("sessions");
+    }
+    
+    // One file per project, named after a hash of its canonical root
+    QFileInfo rootInfo(projectRoot);
+    QString root = rootInfo.canonicalFilePath().isEmpty() ? rootInfo.absoluteFilePath() : rootInfo.canonicalFilePath();
+    QByteArray hash = QCryptographicHash::hash(root.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return dir.filePath("sessions/" + QString::fromLatin1(hash) + ".json");
+}
+
+QJsonObject Session::load(const QString& projectRoot)
+{
+    QFile file(getSessionFilePath(projectRoot));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+    
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        return QJsonObject();
+    }
+    return doc.object();
+}
+
+bool Session::save(const QString& projectRoot, const QJsonObject& session)
+{
+    // Written to a temporary file first, so a crash mid-write keeps the old session
+    QSaveFile file(getSessionFilePath(projectRoot));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(session).toJson());
+    return file.commit();
+}
+
+void Session::prefetch(const QString& path)
+{
+    QThreadPool::globalInstance()->start(QRunnable::create([path]() {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return;
+        
+        QByteArray block(PrefetchBlockSize, Qt::Uninitialized);
+        while (file.read(block.data(), block.size()) > 0) {
+        }
+    }));
+}
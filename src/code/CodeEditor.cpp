@@ -1,5 +1,7 @@
 #include "code/CodeEditor.hpp"
 #include "code/FindReplaceDialog.hpp"
+#include "code/LargeFileView.hpp"
+#include "code/FileSaver.hpp"
 #include "MainWindow.hpp"
 #include "AppSettings.hpp"
 #include <QPainter>
@@ -10,18 +12,31 @@
 #include <QApplication>
 #include <QShortcut>
 #include <QKeySequence>
+#include <QProgressBar>
+#include <QFileInfo>
 
 using namespace openide::code;
 
 CodeEditor::CodeEditor(MainWindow* parent, openide::AppSettings* settings)
     : QPlainTextEdit(parent ? parent->getCentralWidget() : parent)
     , m_parent{parent}
-    , m_syntaxHighlighter{this->document()}
     , m_isModified{false}
     , m_lineNumberArea{nullptr}
     , m_isDarkTheme{false}
     , m_findReplaceDialog{nullptr}
+    , m_loadProgressBar{nullptr}
+    , m_largeFileView{nullptr}
+    , m_largeFileThreshold{64 * 1024 * 1024}
+    , m_fileType{FileType::UNKNOWN}
+    , m_isUnloaded{false}
+    , m_hasSavedViewState{false}
+    , m_savedCursorPosition{0}
+    , m_savedScrollValue{0}
+    , m_pendingLine{-1}
 {
+    m_hiddenTimer.start();
+    attachDocument(std::make_shared<EditorDocument>());
+    
     if (!parent) return;
 
     // Apply settings if provided, otherwise use defaults
@@ -44,14 +59,6 @@ CodeEditor::CodeEditor(MainWindow* parent, openide::AppSettings* settings)
     layout->addWidget(this, 0, 1);
     this->setVisible(false);
 
-    // handler for dirty state (modified since last save)
-    connect(this->document(), &QTextDocument::modificationChanged, this, [this](bool modified){
-        m_isModified = modified;
-        if (modified) {
-            emit fileModified();
-        }
-    });
-
     // Line number area setup
     m_lineNumberArea = new LineNumberArea(this);
     m_lineNumberArea->setAttribute(Qt::WA_OpaquePaintEvent);
@@ -60,6 +67,7 @@ CodeEditor::CodeEditor(MainWindow* parent, openide::AppSettings* settings)
     connect(this, &CodeEditor::blockCountChanged, this, &CodeEditor::updateLineNumberAreaWidth);
     connect(this, &CodeEditor::updateRequest, this, &CodeEditor::updateLineNumberArea);
     connect(this, &CodeEditor::cursorPositionChanged, this, &CodeEditor::highlightCurrentLine);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &CodeEditor::updateHighlightViewport);
     
     updateLineNumberAreaWidth(0);
     
@@ -70,7 +78,7 @@ CodeEditor::CodeEditor(MainWindow* parent, openide::AppSettings* settings)
     m_isDarkTheme = (luminance < 128);
     
     // Initialize syntax highlighter with detected theme
-    m_syntaxHighlighter.updateTheme(m_isDarkTheme);
+    m_document->highlighter().updateTheme(m_isDarkTheme);
     
     highlightCurrentLine();
     
@@ -85,11 +93,162 @@ CodeEditor::~CodeEditor()
         delete m_findReplaceDialog;
         m_findReplaceDialog = nullptr;
     }
+    
+    // Let go of the shared document while this view is still intact; it is
+    // destroyed with the last view showing it
+    disconnect(m_document.get(), nullptr, this, nullptr);
+    QPlainTextEdit::setDocument(nullptr);
+    m_document.reset();
+}
+
+void CodeEditor::attachDocument(std::shared_ptr<EditorDocument> document)
+{
+    if (m_document) {
+        disconnect(m_document.get(), nullptr, this, nullptr);
+        disconnect(m_document->document(), nullptr, this, nullptr);
+    }
+    m_document = std::move(document);
+    QPlainTextEdit::setDocument(m_document->document());
+    m_isModified = m_document->document()->isModified();
+
+    // handler for dirty state (modified since last save)
+    connect(m_document->document(), &QTextDocument::modificationChanged, this, [this](bool modified){
+        m_isModified = modified;
+        if (modified && !m_document->isLoading()) {
+            emit fileModified();
+        }
+    });
+    connect(m_document.get(), &EditorDocument::loadProgressChanged, this, &CodeEditor::updateLoadState);
+    connect(m_document.get(), &EditorDocument::loadFinished, this, &CodeEditor::updateLoadState);
+}
+
+void CodeEditor::shareDocument(CodeEditor* source)
+{
+    if (!source || source == this) return;
+    
+    attachDocument(source->m_document);
+    m_filePath = source->m_filePath;
+    moveCursor(QTextCursor::Start);
+    updateHighlightViewport();
+    updateLoadState();
+}
+
+void CodeEditor::setFile(const QString& path, enum FileType fileType)
+{
+    m_filePath = path;
+    m_fileType = fileType;
+    m_isUnloaded = true;
+}
+
+void CodeEditor::ensureLoaded(CodeEditor* source)
+{
+    if (!m_isUnloaded) return;
+    m_isUnloaded = false;
+    
+    if (source && source != this && !source->isUnloaded() && !source->largeFileView()) {
+        shareDocument(source);
+    } else {
+        // loadFile() only sets the path on success. A file that can't be read
+        // leaves the editor a placeholder, which is never saved over the file
+        // with nothing nor shared, and tries again when it is next shown.
+        QString path = m_filePath;
+        m_filePath.clear();
+        loadFile(path, m_fileType);
+        if (m_filePath.isEmpty()) {
+            m_filePath = path;
+            m_isUnloaded = true;
+            emit loadFailed();
+        }
+    }
+}
+
+bool CodeEditor::unload()
+{
+    if (m_isUnloaded || m_largeFileView || m_isModified || m_filePath.isEmpty() || m_document->isLoading()) {
+        return false;
+    }
+    
+    m_savedCursorPosition = textCursor().position();
+    m_savedScrollValue = verticalScrollBar()->value();
+    m_hasSavedViewState = true;
+    
+    // Other views may still show the old document; it is freed with the last
+    const qreal tabStop = tabStopDistance();
+    attachDocument(std::make_shared<EditorDocument>());
+    document()->setDefaultFont(font());
+    setTabStopDistance(tabStop);
+    setWordWrapMode(QTextOption::NoWrap);
+    m_document->highlighter().updateTheme(m_isDarkTheme);
+    m_isUnloaded = true;
+    return true;
+}
+
+bool CodeEditor::isUnloaded() const
+{
+    return m_isUnloaded;
+}
+
+qint64 CodeEditor::hiddenFor() const
+{
+    return m_hiddenTimer.isValid() ? m_hiddenTimer.elapsed() : -1;
+}
+
+int CodeEditor::cursorPosition() const
+{
+    return m_hasSavedViewState ? m_savedCursorPosition : textCursor().position();
+}
+
+int CodeEditor::scrollPosition() const
+{
+    return m_hasSavedViewState ? m_savedScrollValue : verticalScrollBar()->value();
+}
+
+void CodeEditor::setViewState(int cursorPosition, int scrollPosition)
+{
+    m_savedCursorPosition = cursorPosition;
+    m_savedScrollValue = scrollPosition;
+    m_hasSavedViewState = true;
+    if (!m_isUnloaded) {
+        restoreViewState();
+    }
+}
+
+void CodeEditor::goToLine(int line)
+{
+    m_pendingLine = line;
+    if (!m_isUnloaded) {
+        restoreViewState();
+    }
+}
+
+void CodeEditor::restoreViewState()
+{
+    // Wait for the whole file, so positions past the first chunk exist
+    if (m_document->isLoading()) return;
+    
+    if (m_hasSavedViewState) {
+        m_hasSavedViewState = false;
+        QTextCursor cursor(document());
+        cursor.setPosition(qBound(0, m_savedCursorPosition, document()->characterCount() - 1));
+        setTextCursor(cursor);
+        verticalScrollBar()->setValue(m_savedScrollValue);
+    }
+    
+    // A requested line wins over the restored position
+    if (m_pendingLine >= 0) {
+        QTextBlock block = document()->findBlockByNumber(qMin(m_pendingLine, document()->blockCount() - 1));
+        m_pendingLine = -1;
+        setTextCursor(QTextCursor(block));
+        centerCursor();
+    }
 }
 
 void CodeEditor::setModified(bool isModified)
 {
     QPlainTextEdit::document()->setModified(isModified);
+    if (m_largeFileView) {
+        m_largeFileView->setModified(isModified);
+    }
     m_isModified = isModified;
 }
 
@@ -106,31 +265,121 @@ void CodeEditor::setComponentVisible(bool isVisible)
 
 void CodeEditor::loadFile(const QString& path, enum FileType fileType)
 {
-    QFile file(path);
-    if (!file.exists()) return;
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return;
+    QFileInfo fileInfo(path);
+    if (!fileInfo.exists()) return;
 
-    QTextStream inFile(&file);
-    QString fileContent = inFile.readAll();
+    if (fileInfo.size() >= m_largeFileThreshold) {
+        openLargeFile(path);
+        return;
+    }
 
-    // Set file type for tree-sitter syntax highlighting
-    m_syntaxHighlighter.setFileType(fileType);
-    this->setPlainText(fileContent);
-    m_syntaxHighlighter.rehighlight();
+    if (!m_document->load(path, fileType)) return;
+    m_filePath = path;
+    m_fileType = fileType;
+    moveCursor(QTextCursor::Start);
+    updateHighlightViewport();
+    updateLoadState();
+}
+
+void CodeEditor::updateLoadState()
+{
+    // Every view of a document is read-only until the document has loaded
+    const bool loading = m_document->isLoading();
+    setReadOnly(loading);
+    if (!loading) {
+        if (m_loadProgressBar) {
+            m_loadProgressBar->hide();
+        }
+        restoreViewState();
+        return;
+    }
+    
+    if (!m_loadProgressBar) {
+        m_loadProgressBar = new QProgressBar(this);
+        m_loadProgressBar->setRange(0, 100);
+        m_loadProgressBar->setTextVisible(true);
+        m_loadProgressBar->setGeometry(QRect(contentsRect().right() - 200, contentsRect().top(), 200, 20));
+    }
+    m_loadProgressBar->setValue(m_document->loadProgress());
+    m_loadProgressBar->show();
+}
+
+bool CodeEditor::isLoading() const
+{
+    return m_document->isLoading();
+}
+
+LargeFileView* CodeEditor::largeFileView() const
+{
+    return m_largeFileView;
+}
 
+void CodeEditor::openLargeFile(const QString& path)
+{
+    if (!m_largeFileView) {
+        m_largeFileView = new LargeFileView(this);
+        m_largeFileView->setFont(font());
+        m_largeFileView->setTabStopSpaces(qRound(tabStopDistance() / QFontMetricsF(font()).horizontalAdvance(' ')));
+        m_largeFileView->setDarkTheme(m_isDarkTheme);
+        connect(m_largeFileView, &LargeFileView::modificationChanged, this, [this](bool modified){
+            m_isModified = modified;
+            if (modified) {
+                emit fileModified();
+            }
+        });
+        connect(m_largeFileView, &LargeFileView::saveReady, this, &CodeEditor::saveFile);
+    }
+    if (!m_largeFileView->openFile(path)) {
+        delete m_largeFileView;
+        m_largeFileView = nullptr;
+        return;
+    }
+
+    // The view covers this editor and draws its own gutter; the document
+    // underneath stays empty so QTextDocument never sees the file
+    m_document->highlighter().setFileType(FileType::UNKNOWN);
+    clear();
+    setReadOnly(true);
+    if (m_lineNumberArea) {
+        m_lineNumberArea->hide();
+    }
+    setViewportMargins(0, 0, 0, 0);
+    m_largeFileView->setGeometry(rect());
+    m_largeFileView->show();
+    setFocusProxy(m_largeFileView);
     m_filePath = path;
 }
 
-void CodeEditor::saveFile() const
+void CodeEditor::saveFile()
 {
-    if (m_filePath.isEmpty()) return;
-    QString fileContent = QPlainTextEdit::document()->toPlainText();
-    QFile file(m_filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return;
+    // A partially loaded document would truncate the file
+    // A placeholder's empty document isn't the file's contents either
+    if (m_filePath.isEmpty() || m_isUnloaded || m_document->isLoading()) return;
+
+    // Snapshot here on the GUI thread; encoding and writing happen on the
+    // save pool, so the editor stays responsive and edits can continue
+    FileSaver::Writer writer;
+    QIODevice::OpenMode mode;
+    int revision;
+    if (m_largeFileView) {
+        // Runs again on saveReady() if the view isn't ready yet
+        if (!m_largeFileView->requestSave()) return;
+        writer = m_largeFileView->snapshotWriter();
+        revision = m_largeFileView->revision();
+    } else {
+        writer = FileSaver::textWriter(document()->toPlainText());
+        mode = QIODevice::Text;
+        revision = document()->revision();
+    }
 
-    QTextStream out(&file);
-    out.setEncoding(QStringConverter::Utf8);
-    out << fileContent;
+    FileSaver::save(m_filePath, mode, writer, this, [this, revision](bool succeeded, const QString& error) {
+        // Edits made while the save was running aren't on disk yet
+        int currentRevision = m_largeFileView ? m_largeFileView->revision() : document()->revision();
+        if (succeeded && currentRevision == revision) {
+            setModified(false);
+        }
+        emit saveFinished(succeeded, error);
+    });
 }
 
 const QString& CodeEditor::getFilePath() const
@@ -153,6 +402,7 @@ int CodeEditor::lineNumberAreaWidth()
 
 void CodeEditor::updateLineNumberAreaWidth(int /* newBlockCount */)
 {
+    if (m_largeFileView) return;
     setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
 }
 
@@ -173,6 +423,40 @@ void CodeEditor::resizeEvent(QResizeEvent* event)
     
     QRect cr = contentsRect();
     m_lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    if (m_loadProgressBar) {
+        m_loadProgressBar->setGeometry(QRect(cr.right() - 200, cr.top(), 200, 20));
+    }
+    if (m_largeFileView) {
+        m_largeFileView->setGeometry(rect());
+    }
+    
+    updateHighlightViewport();
+}
+
+void CodeEditor::showEvent(QShowEvent* event)
+{
+    m_hiddenTimer.invalidate();
+    if (m_isUnloaded) {
+        emit loadRequested();
+        ensureLoaded();
+    }
+    QPlainTextEdit::showEvent(event);
+}
+
+void CodeEditor::hideEvent(QHideEvent* event)
+{
+    QPlainTextEdit::hideEvent(event);
+    m_hiddenTimer.start();
+}
+
+void CodeEditor::updateHighlightViewport()
+{
+    // Lines don't wrap, so every visible row is one line-height tall
+    int firstRow = firstVisibleBlock().blockNumber();
+    int rowCount = viewport()->height() / qMax(1, fontMetrics().height()) + 1;
+    // With several views of one document, the one scrolled last sets the
+    // query window; rows highlighted for the others keep their formats
+    m_document->highlighter().setVisibleRows(firstRow, firstRow + rowCount);
 }
 
 void CodeEditor::keyPressEvent(QKeyEvent* event)
@@ -409,8 +693,11 @@ void CodeEditor::updateTheme(bool isDarkTheme)
     m_isDarkTheme = isDarkTheme;
     
     // Update syntax highlighter theme
-    m_syntaxHighlighter.updateTheme(isDarkTheme);
-    m_syntaxHighlighter.rehighlight();
+    m_document->highlighter().updateTheme(isDarkTheme);
+    m_document->highlighter().rehighlight();
+    if (m_largeFileView) {
+        m_largeFileView->setDarkTheme(isDarkTheme);
+    }
     
     highlightCurrentLine();
     if (m_lineNumberArea) {
@@ -430,6 +717,11 @@ void CodeEditor::applySettings(openide::AppSettings* settings)
     QFont font = settings->font();
     setFont(font);
     setTabStopDistance(QFontMetricsF(font).horizontalAdvance(' ') * settings->tabSpace());
+    m_largeFileThreshold = static_cast<qint64>(settings->largeFileThresholdMB()) * 1024 * 1024;
+    if (m_largeFileView) {
+        m_largeFileView->setFont(font);
+        m_largeFileView->setTabStopSpaces(settings->tabSpace());
+    }
     
     // Update line number area if it exists
     if (m_lineNumberArea) {
@@ -5,12 +5,23 @@
 #include "MainWindow.hpp"
 #include "AppSettings.hpp"
 #include "FileType.hpp"
+#include "Session.hpp"
+#include <QStyle>
 #include <QTabBar>
 #include <QMouseEvent>
 #include <QFileInfo>
+#include <QMessageBox>
+#include <QSet>
+#include <QJsonArray>
 
 using namespace openide::code;
 
+namespace
+{
+// Bumped when the session layout changes; older sessions are ignored
+const int SessionVersion = 1;
+}
+
 CodeTabPane::CodeTabPane(MainWindow *parent)
     : QWidget(parent ? parent->getCentralWidget() : parent)
     , m_parent(parent)
@@ -21,6 +32,7 @@ CodeTabPane::CodeTabPane(MainWindow *parent)
     , m_contextMenuPane(nullptr)
     , m_dragSourcePane(nullptr)
     , m_dragSourceIndex(-1)
+    , m_unloadTimer(new QTimer(this))
 {
     // Create root container (starts as a leaf with one tab widget)
     m_root = new PaneContainer(m_parent, PaneContainer::Type::Leaf);
@@ -73,6 +85,11 @@ CodeTabPane::CodeTabPane(MainWindow *parent)
     connect(saveAction, &QAction::triggered, this, [this] {
         saveActiveFile();
     });
+    
+    // Release the documents of tabs nobody has looked at in a while
+    m_unloadTimer->setInterval(UnloadCheckIntervalMs);
+    connect(m_unloadTimer, &QTimer::timeout, this, &CodeTabPane::unloadHiddenEditors);
+    m_unloadTimer->start();
 }
 
 void CodeTabPane::setupTabWidget(QTabWidget* tabWidget)
@@ -123,6 +140,18 @@ void CodeTabPane::connectEditorSignals(CodeEditor* editor, QTabWidget* tabWidget
     
     // Disconnect any existing fileModified connections to prevent duplicates
     disconnect(editor, &CodeEditor::fileModified, this, nullptr);
+    disconnect(editor, &CodeEditor::saveFinished, this, nullptr);
+    disconnect(editor, &CodeEditor::loadRequested, this, nullptr);
+    disconnect(editor, &CodeEditor::loadFailed, this, nullptr);
+    
+    // Placeholders load when first shown, sharing an open view's document
+    connect(editor, &CodeEditor::loadRequested, this, [this, editor]() {
+        markLoadFailed(editor, false);
+        materializeEditor(editor);
+    });
+    connect(editor, &CodeEditor::loadFailed, this, [this, editor]() {
+        markLoadFailed(editor, true);
+    });
     
     // Connect fileModified signal to mark the tab as dirty
     // Dynamically find the tabWidget containing this editor instead of capturing it
@@ -150,6 +179,38 @@ void CodeTabPane::connectEditorSignals(CodeEditor* editor, QTabWidget* tabWidget
             }
         }
     });
+    
+    // Saves complete asynchronously; clear the dirty marker only once the
+    // file is on disk and nothing was typed in the meantime
+    connect(editor, &CodeEditor::saveFinished, this, [this, editor](bool succeeded, const QString& error) {
+        if (!editor || !m_root) return;
+        
+        if (!succeeded) {
+            QMessageBox::warning(this, "Save Failed",
+                                 QString("Could not save %1:\n%2").arg(editor->getFilePath(), error));
+            return;
+        }
+        if (editor->isModified()) return;
+        
+        QList<QTabWidget*> allTabWidgets;
+        m_root->getAllTabWidgets(allTabWidgets);
+        
+        // Split views share the document, so every tab showing it is now clean
+        for (QTabWidget* tw : allTabWidgets) {
+            if (!tw) continue;
+            
+            for (int i = 0; i < tw->count(); ++i) {
+                CodeEditor* view = qobject_cast<CodeEditor*>(tw->widget(i));
+                if (view && view->document() == editor->document()) {
+                    // Remove asterisk from tab name
+                    QString tabText = tw->tabText(i);
+                    if (tabText.endsWith(" *")) {
+                        tw->setTabText(i, tabText.left(tabText.length() - 2));
+                    }
+                }
+            }
+        }
+    });
 }
 
 PaneContainer* CodeTabPane::findContainerForTabWidget(QTabWidget* tabWidget)
@@ -228,6 +289,84 @@ void CodeTabPane::addTab(CodeEditor *editor, const QString &tabName)
         
         // Connect editor signals to update tab state
         connectEditorSignals(editor, targetWidget);
+        registerEditor(editor);
+    }
+}
+
+QString CodeTabPane::canonicalPath(const QString& path)
+{
+    // Resolves symlinks and relative parts; files that no longer exist fall
+    // back to their absolute path
+    QFileInfo fileInfo(path);
+    QString canonical = fileInfo.canonicalFilePath();
+    return canonical.isEmpty() ? fileInfo.absoluteFilePath() : canonical;
+}
+
+void CodeTabPane::registerEditor(CodeEditor* editor)
+{
+    if (!editor || m_editorPaths.contains(editor)) return;
+    
+    QString path = canonicalPath(editor->getFilePath());
+    m_editorPaths.insert(editor, path);
+    m_editorsByPath[path].append(editor);
+    
+    // Catch editors deleted without going through the close handlers
+    connect(editor, &QObject::destroyed, this, [this, editor]() {
+        unregisterEditor(editor);
+    });
+}
+
+void CodeTabPane::unregisterEditor(CodeEditor* editor)
+{
+    // Only used as a key here, so editor may already be destroyed
+    auto it = m_editorPaths.find(editor);
+    if (it == m_editorPaths.end()) return;
+    
+    auto views = m_editorsByPath.find(it.value());
+    if (views != m_editorsByPath.end()) {
+        views->removeOne(editor);
+        if (views->isEmpty()) {
+            m_editorsByPath.erase(views);
+        }
+    }
+    m_editorPaths.erase(it);
+}
+
+void CodeTabPane::materializeEditor(CodeEditor* editor)
+{
+    if (!editor || !editor->isUnloaded()) return;
+    
+    CodeEditor* source = nullptr;
+    for (CodeEditor* view : m_editorsByPath.value(m_editorPaths.value(editor))) {
+        if (view != editor && !view->isUnloaded()) {
+            source = view;
+            break;
+        }
+    }
+    editor->ensureLoaded(source);
+}
+
+void CodeTabPane::markLoadFailed(CodeEditor* editor, bool failed)
+{
+    if (!editor || !m_root) return;
+    
+    QList<QTabWidget*> allTabWidgets;
+    m_root->getAllTabWidgets(allTabWidgets);
+    for (QTabWidget* tw : allTabWidgets) {
+        const int index = tw ? tw->indexOf(editor) : -1;
+        if (index < 0) continue;
+        tw->setTabIcon(index, failed ? style()->standardIcon(QStyle::SP_MessageBoxWarning) : QIcon());
+        tw->setTabToolTip(index, failed ? QString("Could not open %1").arg(editor->getFilePath()) : QString());
+    }
+}
+
+void CodeTabPane::unloadHiddenEditors()
+{
+    for (auto it = m_editorPaths.cbegin(); it != m_editorPaths.cend(); ++it) {
+        CodeEditor* editor = it.key();
+        if (editor->hiddenFor() >= UnloadAfterHiddenMs) {
+            editor->unload();
+        }
     }
 }
 
@@ -466,6 +605,7 @@ void CodeTabPane::closeTab(QTabWidget* pane, int tabIndex)
     pane->removeTab(tabIndex);
     
     if (widget) {
+        unregisterEditor(qobject_cast<CodeEditor*>(widget));
         widget->deleteLater();
     }
     
@@ -498,6 +638,7 @@ void CodeTabPane::closeAllOtherTabs(QTabWidget* pane, int tabIndex)
             QWidget* widget = pane->widget(i);
             pane->removeTab(i);
             if (widget) {
+                unregisterEditor(qobject_cast<CodeEditor*>(widget));
                 widget->deleteLater();
             }
         }
@@ -512,6 +653,7 @@ void CodeTabPane::closeAllTabsInPane(QTabWidget* pane)
         QWidget* widget = pane->widget(0);
         pane->removeTab(0);
         if (widget) {
+            unregisterEditor(qobject_cast<CodeEditor*>(widget));
             widget->deleteLater();
         }
     }
@@ -543,6 +685,7 @@ void CodeTabPane::closeAllTabs()
             QWidget* widget = tw->widget(0);
             tw->removeTab(0);
             if (widget) {
+                unregisterEditor(qobject_cast<CodeEditor*>(widget));
                 widget->deleteLater();
             }
         }
@@ -629,6 +772,7 @@ void CodeTabPane::splitHorizontal(QTabWidget* pane, int tabIndex)
         
         // Connect signals for the new editor
         connectEditorSignals(newEditor, rightTabWidget);
+        registerEditor(newEditor);
     }
     
     // Update pane numbers after splitting
@@ -667,6 +811,7 @@ void CodeTabPane::splitVertical(QTabWidget* pane, int tabIndex)
         
         // Connect signals for the new editor
         connectEditorSignals(newEditor, rightTabWidget);
+        registerEditor(newEditor);
     }
     
     // Update pane numbers after splitting
@@ -677,16 +822,23 @@ CodeEditor* CodeTabPane::duplicateEditor(CodeEditor* source)
 {
     if (!source) return nullptr;
     
+    // Splitting a background tab from its context menu
+    materializeEditor(source);
+    
     // Create new editor with same settings
     CodeEditor* newEditor = new CodeEditor(m_parent, m_parent->getAppSettings());
     
-    // Get the file path and determine its type
-    QString filePath = source->getFilePath();
-    QFileInfo fileInfo(filePath);
-    openide::FileType fileType = openide::FileTypeUtil::fromExtension(fileInfo.suffix());
-    
-    // Load the same file
-    newEditor->loadFile(filePath, fileType);
+    if (source->largeFileView()) {
+        // Large files have no QTextDocument to share; open a second view
+        QString filePath = source->getFilePath();
+        QFileInfo fileInfo(filePath);
+        openide::FileType fileType = openide::FileTypeUtil::fromExtension(fileInfo.suffix());
+        newEditor->loadFile(filePath, fileType);
+    } else {
+        // Show the same document, so the file is stored and parsed once and
+        // edits appear in both views
+        newEditor->shareDocument(source);
+    }
     
     // Install event filter to track focus
     newEditor->installEventFilter(this);
@@ -798,40 +950,21 @@ void CodeTabPane::saveActiveFile()
     
     CodeEditor* editor = qobject_cast<CodeEditor*>(active->widget(currentIdx));
     if (editor) {
+        // The tab is marked clean when the save completes (see connectEditorSignals)
         editor->saveFile();
-        
-        // Reset the modified state so future changes will trigger the dirty indicator
-        editor->setModified(false);
-        
-        // Remove asterisk from tab name
-        QString tabText = active->tabText(currentIdx);
-        if (tabText.endsWith(" *")) {
-            active->setTabText(currentIdx, tabText.left(tabText.length() - 2));
-        }
     }
 }
 
 void CodeTabPane::saveAllActiveFiles()
 {
-    QList<QTabWidget*> allTabWidgets;
-    if (m_root) {
-        m_root->getAllTabWidgets(allTabWidgets);
-    }
-    
-    for (QTabWidget* tw : allTabWidgets) {
-        for (int i = 0; i < tw->count(); ++i) {
-            CodeEditor* editor = qobject_cast<CodeEditor*>(tw->widget(i));
-            if (editor) {
+    // Every save is queued before any completes, so they run in parallel.
+    // Split views share a document, which only needs saving once.
+    for (auto it = m_editorsByPath.cbegin(); it != m_editorsByPath.cend(); ++it) {
+        QSet<QTextDocument*> savedDocuments;
+        for (CodeEditor* editor : it.value()) {
+            if (editor->largeFileView() || !savedDocuments.contains(editor->document())) {
+                savedDocuments.insert(editor->document());
                 editor->saveFile();
-                
-                // Reset the modified state so future changes will trigger the dirty indicator
-                editor->setModified(false);
-                
-                // Remove asterisk from tab name
-                QString tabText = tw->tabText(i);
-                if (tabText.endsWith(" *")) {
-                    tw->setTabText(i, tabText.left(tabText.length() - 2));
-                }
             }
         }
     }
@@ -839,53 +972,202 @@ void CodeTabPane::saveAllActiveFiles()
 
 bool CodeTabPane::fileIsOpen(const QString& path) const
 {
-    QList<QTabWidget*> allTabWidgets;
-    if (m_root) {
-        m_root->getAllTabWidgets(const_cast<QList<QTabWidget*>&>(allTabWidgets));
-    }
-    
-    for (QTabWidget* tw : allTabWidgets) {
-        for (int i = 0; i < tw->count(); ++i) {
-            CodeEditor* editor = qobject_cast<CodeEditor*>(tw->widget(i));
-            if (editor && editor->getFilePath() == path) {
-                return true;
+    return m_editorsByPath.contains(canonicalPath(path));
+}
+
+void CodeTabPane::openFile(const QString& path, int line)
+{
+    CodeEditor* editor = nullptr;
+    QTabWidget* tabWidget = nullptr;
+    
+    // Prefer a view in the active pane when the file is open in several
+    const QList<CodeEditor*> views = m_editorsByPath.value(canonicalPath(path));
+    for (CodeEditor* view : views) {
+        for (QWidget* ancestor = view->parentWidget(); ancestor; ancestor = ancestor->parentWidget()) {
+            if (QTabWidget* tw = qobject_cast<QTabWidget*>(ancestor)) {
+                if (!editor || tw == m_activeTabWidget) {
+                    editor = view;
+                    tabWidget = tw;
+                }
+                break;
             }
         }
     }
-    return false;
+    
+    if (editor) {
+        tabWidget->setCurrentWidget(editor);
+        m_activeTabWidget = tabWidget;
+    } else {
+        QFileInfo fileInfo(path);
+        if (!fileInfo.isFile()) return;
+        editor = new CodeEditor(m_parent, m_parent->getAppSettings());
+        editor->setFile(fileInfo.filePath(), openide::FileTypeUtil::fromExtension(fileInfo.suffix().toLower()));
+        addTab(editor, fileInfo.fileName());
+    }
+    
+    if (line >= 0) {
+        editor->goToLine(line);
+    }
+    editor->setFocus();
 }
 
-void CodeTabPane::updateAllEditorsTheme(bool isDarkTheme)
+QJsonObject CodeTabPane::saveSession() const
 {
-    QList<QTabWidget*> allTabWidgets;
+    QJsonObject session;
+    session["version"] = SessionVersion;
     if (m_root) {
-        m_root->getAllTabWidgets(allTabWidgets);
+        session["root"] = saveContainer(m_root);
+    }
+    return session;
+}
+
+QJsonObject CodeTabPane::saveContainer(PaneContainer* container) const
+{
+    QJsonObject node;
+    if (!container) return node;
+    
+    if (container->isBranch()) {
+        QSplitter* splitter = container->splitter();
+        node["orientation"] = splitter->orientation() == Qt::Vertical ? "vertical" : "horizontal";
+        QJsonArray sizes;
+        for (int size : splitter->sizes()) {
+            sizes.append(size);
+        }
+        node["sizes"] = sizes;
+        node["first"] = saveContainer(container->leftChild());
+        node["second"] = saveContainer(container->rightChild());
+        return node;
     }
     
-    for (QTabWidget* tw : allTabWidgets) {
-        for (int i = 0; i < tw->count(); ++i) {
-            CodeEditor* editor = qobject_cast<CodeEditor*>(tw->widget(i));
-            if (editor) {
-                editor->updateTheme(isDarkTheme);
-            }
+    QTabWidget* tw = container->tabWidget();
+    QJsonArray tabs;
+    int current = -1;
+    for (int i = 0; tw && i < tw->count(); ++i) {
+        CodeEditor* editor = qobject_cast<CodeEditor*>(tw->widget(i));
+        if (!editor || editor->getFilePath().isEmpty()) continue;
+        
+        if (i == tw->currentIndex()) {
+            current = tabs.size();
         }
+        QJsonObject tab;
+        tab["path"] = editor->getFilePath();
+        tab["cursor"] = editor->cursorPosition();
+        tab["scroll"] = editor->scrollPosition();
+        tabs.append(tab);
     }
+    node["tabs"] = tabs;
+    node["current"] = current;
+    return node;
 }
 
-void CodeTabPane::updateAllEditorsSettings(openide::AppSettings* settings)
+bool CodeTabPane::isValidSession(const QJsonObject& session)
 {
-    QList<QTabWidget*> allTabWidgets;
-    if (m_root) {
-        m_root->getAllTabWidgets(allTabWidgets);
+    return session["version"].toInt() == SessionVersion && session["root"].isObject();
+}
+
+bool CodeTabPane::hasUnsavedChanges() const
+{
+    for (auto it = m_editorPaths.cbegin(); it != m_editorPaths.cend(); ++it) {
+        if (it.key()->isModified()) return true;
     }
+    return false;
+}
+
+void CodeTabPane::restoreSession(const QJsonObject& session)
+{
+    // Checked before closing anything, so a missing or outdated session
+    // keeps the tabs that are open
+    if (!m_root || !isValidSession(session)) return;
     
-    for (QTabWidget* tw : allTabWidgets) {
-        for (int i = 0; i < tw->count(); ++i) {
-            CodeEditor* editor = qobject_cast<CodeEditor*>(tw->widget(i));
-            if (editor) {
-                editor->applySettings(settings);
-            }
+    closeAllTabs();
+    
+    restoreContainer(m_root, session["root"].toObject());
+    
+    // Drop panes whose files have all gone
+    m_root->simplify();
+    m_activeTabWidget = getActiveTabWidget();
+    updatePaneNumbers();
+}
+
+void CodeTabPane::restoreContainer(PaneContainer* container, const QJsonObject& node)
+{
+    if (node.contains("first")) {
+        if (node["orientation"].toString() == "vertical") {
+            container->splitHorizontal();
+        } else {
+            container->splitVertical();
+        }
+        
+        // Setup tab widgets for the new children (signal might have been missed)
+        if (container->leftChild()->tabWidget()) {
+            setupTabWidget(container->leftChild()->tabWidget());
+        }
+        if (container->rightChild()->tabWidget()) {
+            setupTabWidget(container->rightChild()->tabWidget());
+        }
+        restoreContainer(container->leftChild(), node["first"].toObject());
+        restoreContainer(container->rightChild(), node["second"].toObject());
+        
+        QJsonArray sizes = node["sizes"].toArray();
+        if (sizes.size() == 2) {
+            container->splitter()->setSizes({sizes[0].toInt(), sizes[1].toInt()});
         }
+        return;
+    }
+    
+    QTabWidget* tw = container->tabWidget();
+    if (!tw) return;
+    
+    // Tabs are only placeholders here; each reads its file when first shown
+    QList<CodeEditor*> editors;
+    int current = 0;
+    const QJsonArray tabs = node["tabs"].toArray();
+    for (int i = 0; i < tabs.size(); ++i) {
+        QJsonObject tab = tabs[i].toObject();
+        QFileInfo fileInfo(tab["path"].toString());
+        if (!fileInfo.isFile()) continue;
+        
+        if (i == node["current"].toInt()) {
+            current = editors.size();
+        }
+        CodeEditor* editor = new CodeEditor(m_parent, m_parent->getAppSettings());
+        editor->setFile(fileInfo.filePath(), openide::FileTypeUtil::fromExtension(fileInfo.suffix().toLower()));
+        editor->setViewState(tab["cursor"].toInt(), tab["scroll"].toInt());
+        editor->installEventFilter(this);
+        connectEditorSignals(editor, tw);
+        registerEditor(editor);
+        editors.append(editor);
+    }
+    if (editors.isEmpty()) return;
+    
+    // The visible tab is added first so it is the only one shown, and so the
+    // only one loaded. Its file is read ahead on the pool, so the disk reads
+    // for every pane's visible tab overlap rather than queue behind the GUI
+    // thread.
+    CodeEditor* visible = editors[current];
+    QFileInfo visibleInfo(visible->getFilePath());
+    if (visibleInfo.size() < static_cast<qint64>(m_parent->getAppSettings()->largeFileThresholdMB()) * 1024 * 1024) {
+        openide::Session::prefetch(visible->getFilePath());
+    }
+    tw->addTab(visible, visibleInfo.fileName());
+    for (int i = 0; i < editors.size(); ++i) {
+        if (i == current) continue;
+        tw->insertTab(i, editors[i], QFileInfo(editors[i]->getFilePath()).fileName());
+    }
+    tw->setCurrentWidget(visible);
+}
+
+void CodeTabPane::updateAllEditorsTheme(bool isDarkTheme)
+{
+    for (auto it = m_editorPaths.cbegin(); it != m_editorPaths.cend(); ++it) {
+        it.key()->updateTheme(isDarkTheme);
+    }
+}
+
+void CodeTabPane::updateAllEditorsSettings(openide::AppSettings* settings)
+{
+    for (auto it = m_editorPaths.cbegin(); it != m_editorPaths.cend(); ++it) {
+        it.key()->applySettings(settings);
     }
 }
 
@@ -0,0 +1,192 @@
+#include "code/EditorDocument.hpp"
+#include "code/QueryRegistry.hpp"
+#include "code/HighlightCache.hpp"
+#include <QCoreApplication>
+#include <QPlainTextDocumentLayout>
+#include <QPointer>
+#include <QTextCursor>
+#include <QThreadPool>
+
+using namespace openide::code;
+
+EditorDocument::EditorDocument()
+    : m_highlighter{&m_document}
+    , m_isLoading{false}
+    , m_loadData{nullptr}
+    , m_loadSize{0}
+    , m_loadOffset{0}
+    , m_loadPendingCR{false}
+    , m_loadGeneration{0}
+    , m_hasCacheLookup{false}
+    , m_cacheFound{false}
+    , m_loadedRevision{-1}
+{
+    // QPlainTextEdit only accepts documents laid out as plain text
+    m_document.setDocumentLayout(new QPlainTextDocumentLayout(&m_document));
+    
+    // Zero-interval timer: one chunk per event loop pass while loading
+    m_loadTimer.setInterval(0);
+    connect(&m_loadTimer, &QTimer::timeout, this, &EditorDocument::loadNextChunk);
+}
+
+EditorDocument::~EditorDocument()
+{
+    cancelLoad();
+}
+
+bool EditorDocument::load(const QString& path, enum FileType fileType)
+{
+    cancelLoad();
+    
+    m_loadFile.setFileName(path);
+    if (!m_loadFile.open(QIODevice::ReadOnly)) return false;
+
+    // Compile the highlight query while the file is read and laid out
+    QueryRegistry::instance().preload(fileType);
+    lookUpCachedHighlights(path, fileType);
+
+    // Decode straight out of the mapping, so the only full copy of the file
+    // in memory is the document itself
+    m_loadSize = m_loadFile.size();
+    m_loadData = m_loadSize > 0 ? m_loadFile.map(0, m_loadSize) : nullptr;
+    if (!m_loadData && m_loadSize > 0) {
+        m_loadBuffer = m_loadFile.readAll();
+        m_loadData = reinterpret_cast<const uchar*>(m_loadBuffer.constData());
+        m_loadSize = m_loadBuffer.size();
+    }
+    m_loadOffset = 0;
+    m_loadPendingCR = false;
+    auto encoding = QStringConverter::encodingForData(QByteArrayView(m_loadData, qMin<qint64>(m_loadSize, 4)));
+    m_loadDecoder = QStringDecoder(encoding.value_or(QStringConverter::Utf8));
+
+    // Set file type for tree-sitter syntax highlighting; each appended chunk
+    // is highlighted through the normal contentsChange path
+    m_highlighter.setFileType(fileType);
+    m_isLoading = true;
+    m_document.setUndoRedoEnabled(false);
+    m_document.clear();
+
+    // Fill the first screenful right away, then the rest between events
+    appendLoadChunk(FirstLoadChunkSize);
+    if (m_isLoading) {
+        m_loadTimer.start();
+    }
+    return true;
+}
+
+int EditorDocument::loadProgress() const
+{
+    return m_loadSize > 0 ? static_cast<int>(m_loadOffset * 100 / m_loadSize) : 100;
+}
+
+void EditorDocument::loadNextChunk()
+{
+    appendLoadChunk(LoadChunkSize);
+    if (m_isLoading) {
+        emit loadProgressChanged(loadProgress());
+    }
+}
+
+void EditorDocument::appendLoadChunk(qint64 chunkSize)
+{
+    const qint64 length = qMin(chunkSize, m_loadSize - m_loadOffset);
+    QString text = m_loadDecoder.decode(QByteArrayView(m_loadData + m_loadOffset, length));
+    m_loadOffset += length;
+    const bool atEnd = m_loadOffset >= m_loadSize;
+
+    // Match QIODevice::Text: CRLF becomes LF, including pairs split across chunks
+    if (m_loadPendingCR) {
+        text.prepend(QLatin1Char('\r'));
+        m_loadPendingCR = false;
+    }
+    if (!atEnd && text.endsWith(QLatin1Char('\r'))) {
+        text.chop(1);
+        m_loadPendingCR = true;
+    }
+    text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+
+    QTextCursor cursor(&m_document);
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+
+    if (atEnd) {
+        finishLoad();
+    }
+}
+
+void EditorDocument::finishLoad()
+{
+    cancelLoad();
+    m_document.setUndoRedoEnabled(true);
+    m_document.setModified(false);
+    m_loadedRevision = m_document.revision();
+    applyCacheLookup();
+    emit loadFinished();
+}
+
+void EditorDocument::lookUpCachedHighlights(const QString& path, enum FileType fileType)
+{
+    ++m_loadGeneration;
+    m_hasCacheLookup = false;
+    m_cacheKey.clear();
+    m_cachedIndex.clear();
+    if (!QueryRegistry::language(fileType)) return;
+
+    // Hashing a large file takes a while, so it runs alongside the load and
+    // the result waits for the text to be complete
+    const int generation = m_loadGeneration;
+    QPointer<EditorDocument> guard(this);
+    QThreadPool::globalInstance()->start([guard, generation, path, fileType]() {
+        const QByteArray key = HighlightCache::key(HighlightCache::hashFile(path), fileType);
+        HighlightIndex index;
+        const bool found = HighlightCache::load(key, index);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, generation, key, found, index]() {
+            if (guard) {
+                guard->onCacheLookup(generation, key, found, index);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void EditorDocument::onCacheLookup(int generation, const QByteArray& key, bool found, const HighlightIndex& index)
+{
+    if (generation != m_loadGeneration || key.isEmpty()) return;
+
+    m_hasCacheLookup = true;
+    m_cacheKey = key;
+    m_cacheFound = found;
+    m_cachedIndex = index;
+    if (!m_isLoading) {
+        applyCacheLookup();
+    }
+}
+
+void EditorDocument::applyCacheLookup()
+{
+    if (!m_hasCacheLookup) return;
+    m_hasCacheLookup = false;
+
+    // Once edited, the text no longer matches the hash the key came from
+    if (m_document.revision() == m_loadedRevision) {
+        if (m_cacheFound) {
+            m_highlighter.setCachedHighlights(m_cachedIndex);
+        } else {
+            m_highlighter.storeInCache(m_cacheKey);
+        }
+    }
+    m_cachedIndex.clear();
+}
+
+void EditorDocument::cancelLoad()
+{
+    m_loadTimer.stop();
+    if (m_loadData && m_loadBuffer.isEmpty()) {
+        m_loadFile.unmap(const_cast<uchar*>(m_loadData));
+    }
+    m_loadData = nullptr;
+    m_loadBuffer.clear();
+    m_loadFile.close();
+    m_loadSize = 0;
+    m_loadOffset = 0;
+    m_isLoading = false;
+}
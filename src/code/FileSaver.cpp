@@ -0,0 +1,110 @@
+#include "code/FileSaver.hpp"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QHash>
+#include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QQueue>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+
+using namespace openide::code;
+
+namespace
+{
+// Characters encoded per write() call by textWriter()
+const qsizetype TextSliceSize = 1024 * 1024;
+
+// Saves of one path run one after another in the order they were made, so
+// an older snapshot is never committed over a newer one. A path has an
+// entry while a save of it runs, holding the saves queued behind that one.
+QMutex queueMutex;
+QHash<QString, QQueue<std::function<void()>>> queuedSaves;
+}
+
+QThreadPool* FileSaver::pool()
+{
+    // Saves are disk-bound, so they get their own pool rather than competing
+    // with highlighting for the global one
+    static QThreadPool* savePool = []() {
+        QThreadPool* threadPool = new QThreadPool();
+        threadPool->setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
+        return threadPool;
+    }();
+    return savePool;
+}
+
+void FileSaver::save(const QString& path, QIODevice::OpenMode mode, Writer writer,
+                     QObject* context, Callback callback)
+{
+    QPointer<QObject> guard(context);
+    const QString key = QFileInfo(path).absoluteFilePath();
+    std::function<void()> task = [path, mode, writer, guard, callback, key]() {
+        bool succeeded = false;
+        QString error;
+        
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly | mode)) {
+            error = file.errorString();
+        } else if (!writer(&file)) {
+            error = file.errorString();
+            file.cancelWriting();
+        } else if (!file.commit()) {
+            error = file.errorString();
+        } else {
+            succeeded = true;
+        }
+        
+        // The guard is only safe to check on the GUI thread, where context lives
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, callback, succeeded, error]() {
+            if (guard) {
+                callback(succeeded, error);
+            }
+        }, Qt::QueuedConnection);
+        
+        startNext(key);
+    };
+    
+    QMutexLocker locker(&queueMutex);
+    auto queue = queuedSaves.find(key);
+    if (queue != queuedSaves.end()) {
+        queue->enqueue(task);
+        return;
+    }
+    queuedSaves.insert(key, QQueue<std::function<void()>>());
+    pool()->start(QRunnable::create(task));
+}
+
+void FileSaver::startNext(const QString& key)
+{
+    QMutexLocker locker(&queueMutex);
+    auto queue = queuedSaves.find(key);
+    if (queue->isEmpty()) {
+        queuedSaves.erase(queue);
+        return;
+    }
+    pool()->start(QRunnable::create(queue->dequeue()));
+}
+
+FileSaver::Writer FileSaver::textWriter(const QString& text)
+{
+    return [text](QIODevice* device) {
+        for (qsizetype pos = 0; pos < text.size(); ) {
+            qsizetype length = qMin(TextSliceSize, text.size() - pos);
+            // Don't split a surrogate pair across slices
+            if (pos + length < text.size() && text.at(pos + length - 1).isHighSurrogate()) {
+                --length;
+            }
+            const QByteArray bytes = QStringView(text).mid(pos, length).toUtf8();
+            if (device->write(bytes) != bytes.size()) {
+                return false;
+            }
+            pos += length;
+        }
+        return true;
+    };
+}
@@ -1,5 +1,6 @@
 #include "code/FindReplaceDialog.hpp"
 #include "code/CodeEditor.hpp"
+#include "code/LargeFileView.hpp"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFormLayout>
@@ -93,18 +94,16 @@ bool FindReplaceDialog::findText(const QString& text, bool forward)
         flags |= QTextDocument::FindBackward;
     }
     
-    bool found = m_editor->find(text, flags);
+    bool found = editorFind(text, flags);
     
     if (found) {
         m_statusLabel->setText("");
         return true;
     } else {
         // Try wrapping around from the beginning
-        QTextCursor cursor = m_editor->textCursor();
-        cursor.movePosition(forward ? QTextCursor::Start : QTextCursor::End);
-        m_editor->setTextCursor(cursor);
+        editorMoveCursor(forward ? QTextCursor::Start : QTextCursor::End);
         
-        found = m_editor->find(text, flags);
+        found = editorFind(text, flags);
         if (found) {
             m_statusLabel->setText("Wrapped around");
             return true;
@@ -134,8 +133,7 @@ void FindReplaceDialog::onReplace()
     }
     
     // Check if current selection matches the search text
-    QTextCursor cursor = m_editor->textCursor();
-    QString selectedText = cursor.selectedText();
+    QString selectedText = editorSelectedText();
     
     bool matches = false;
     if (m_caseSensitiveCheckBox->isChecked()) {
@@ -146,7 +144,10 @@ void FindReplaceDialog::onReplace()
     
     if (matches) {
         // Replace the current selection
-        cursor.insertText(replaceText);
+        if (!editorInsertText(replaceText)) {
+            m_statusLabel->setText("Can't replace until the file has finished loading");
+            return;
+        }
         m_statusLabel->setText("Replaced 1 occurrence");
     }
     
@@ -167,9 +168,8 @@ void FindReplaceDialog::onReplaceAll()
     }
     
     // Move to the beginning
+    editorMoveCursor(QTextCursor::Start);
     QTextCursor cursor = m_editor->textCursor();
-    cursor.movePosition(QTextCursor::Start);
-    m_editor->setTextCursor(cursor);
     
     int count = 0;
     
@@ -184,20 +184,61 @@ void FindReplaceDialog::onReplaceAll()
     // Begin undo block for single undo operation
     cursor.beginEditBlock();
     
-    while (m_editor->find(searchText, flags)) {
-        QTextCursor foundCursor = m_editor->textCursor();
-        foundCursor.insertText(replaceText);
+    bool isEditable = true;
+    while (editorFind(searchText, flags)) {
+        if (!editorInsertText(replaceText)) {
+            isEditable = false;
+            break;
+        }
         count++;
     }
     
     cursor.endEditBlock();
     
-    if (count > 0) {
+    if (!isEditable) {
+        m_statusLabel->setText("Can't replace until the file has finished loading");
+    } else if (count > 0) {
         m_statusLabel->setText(QString("Replaced %1 occurrence(s)").arg(count));
     } else {
         m_statusLabel->setText("Text not found");
     }
 }
 
+bool FindReplaceDialog::editorFind(const QString& text, QTextDocument::FindFlags flags)
+{
+    if (LargeFileView* view = m_editor->largeFileView()) {
+        return view->find(text, flags);
+    }
+    return m_editor->find(text, flags);
+}
+
+void FindReplaceDialog::editorMoveCursor(QTextCursor::MoveOperation operation)
+{
+    if (LargeFileView* view = m_editor->largeFileView()) {
+        view->moveCursor(operation);
+        return;
+    }
+    QTextCursor cursor = m_editor->textCursor();
+    cursor.movePosition(operation);
+    m_editor->setTextCursor(cursor);
+}
+
+QString FindReplaceDialog::editorSelectedText() const
+{
+    if (LargeFileView* view = m_editor->largeFileView()) {
+        return view->selectedText();
+    }
+    return m_editor->textCursor().selectedText();
+}
+
+bool FindReplaceDialog::editorInsertText(const QString& text)
+{
+    if (LargeFileView* view = m_editor->largeFileView()) {
+        return view->insertText(text);
+    }
+    m_editor->textCursor().insertText(text);
+    return true;
+}
+
 
 
@@ -0,0 +1,137 @@
+#include "code/HighlightCache.hpp"
+#include "code/QueryRegistry.hpp"
+#include "AppSettings.hpp"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+using namespace openide;
+using namespace openide::code;
+
+namespace
+{
+// Bumped whenever the entry layout or HighlightIndex encoding changes
+const quint32 CacheMagic = 0x6f694843; // "oiHC"
+const quint32 CacheVersion = 2;
+}
+
+QByteArray HighlightCache::key(const QByteArray& contentHash, FileType fileType)
+{
+    const CompiledQuery* query = QueryRegistry::instance().highlightQuery(fileType);
+    if (!query || contentHash.isEmpty())
+    {
+        return QByteArray();
+    }
+    
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(contentHash);
+    hash.addData(query->fingerprint);
+    return hash.result().toHex();
+}
+
+QByteArray HighlightCache::hashFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    return hash.addData(&file) ? hash.result() : QByteArray();
+}
+
+bool HighlightCache::load(const QByteArray& key, HighlightIndex& index)
+{
+    QFile file(filePath(key));
+    if (key.isEmpty() || !file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    
+    QDataStream stream(&file);
+    quint32 magic;
+    quint32 version;
+    QByteArray data;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != CacheMagic || version != CacheVersion)
+    {
+        return false;
+    }
+    stream >> data;
+    if (stream.status() != QDataStream::Ok || !index.fromByteArray(data))
+    {
+        return false;
+    }
+    
+    // Recently used entries survive pruning. Setting the time needs write
+    // access (on Windows the handle must allow writing attributes); if it
+    // can't be set, rewriting the entry makes it just as recent.
+    file.close();
+    if (!file.open(QIODevice::ReadWrite)
+        || !file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime))
+    {
+        file.close();
+        write(file.fileName(), data);
+    }
+    return true;
+}
+
+void HighlightCache::store(const QByteArray& key, const HighlightIndex& index)
+{
+    if (key.isEmpty())
+    {
+        return;
+    }
+    
+    if (write(filePath(key), index.toByteArray()))
+    {
+        prune();
+    }
+}
+
+bool HighlightCache::write(const QString& path, const QByteArray& data)
+{
+    // Written to a temporary file first, so a reader never sees half an entry
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << CacheMagic << CacheVersion << data;
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+
+QString HighlightCache::directory()
+{
+    QDir dir(AppSettings::getConfigDirectory());
+    if (!dir.exists("highlight-cache"))
+    {
+        dir.mkpath("highlight-cache");
+    }
+    return dir.filePath("highlight-cache");
+}
+
+QString HighlightCache::filePath(const QByteArray& key)
+{
+    return QDir(directory()).filePath(QString::fromLatin1(key) + ".bin");
+}
+
+void HighlightCache::prune()
+{
+    // Newest first, so everything past the budget is the least recently used
+    const QFileInfoList entries = QDir(directory()).entryInfoList(QStringList() << "*.bin", QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (const QFileInfo& entry : entries)
+    {
+        total += entry.size();
+        if (total > MaxCacheBytes)
+        {
+            QFile::remove(entry.filePath());
+        }
+    }
+}
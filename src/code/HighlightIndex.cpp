@@ -0,0 +1,149 @@
+#include "code/HighlightIndex.hpp"
+#include <QDataStream>
+#include <QIODevice>
+#include <climits>
+
+using namespace openide::code;
+
+void HighlightIndex::build(const QVector<HighlightInfo>& highlights, int firstRow, int lastRow)
+{
+    clear();
+    
+    // Offsets are relative to the first row, so a viewport query deep into a
+    // file doesn't allocate one for every row above it
+    if (firstRow < 0 || lastRow < firstRow)
+    {
+        firstRow = INT_MAX;
+        lastRow = -1;
+        for (const HighlightInfo& info : highlights)
+        {
+            firstRow = qMin(firstRow, info.startRow);
+            lastRow = qMax(lastRow, info.endRow);
+        }
+        if (lastRow < 0)
+        {
+            return;
+        }
+    }
+    m_firstLine = firstRow;
+    const int lineCount = lastRow - firstRow + 1;
+    
+    // Count spans per line, then turn the counts into offsets. Captures
+    // running past the rows are clipped to them.
+    m_lineOffsets.fill(0, lineCount + 1);
+    for (const HighlightInfo& info : highlights)
+    {
+        for (int line = qMax(info.startRow, firstRow); line <= qMin(info.endRow, lastRow); ++line)
+        {
+            m_lineOffsets[line - firstRow + 1]++;
+        }
+    }
+    for (int line = 0; line < lineCount; ++line)
+    {
+        m_lineOffsets[line + 1] += m_lineOffsets[line];
+    }
+    
+    // Fill each line's bucket, splitting multi-line captures per line
+    m_spans.resize(m_lineOffsets[lineCount]);
+    QVector<int> fill(m_lineOffsets.begin(), m_lineOffsets.end() - 1);
+    for (const HighlightInfo& info : highlights)
+    {
+        for (int line = qMax(info.startRow, firstRow); line <= qMin(info.endRow, lastRow); ++line)
+        {
+            Span span;
+            span.start = (line == info.startRow) ? info.startColumn : 0;
+            span.end = (line == info.endRow) ? info.endColumn : -1;
+            span.type = info.type;
+            m_spans[fill[line - firstRow]++] = span;
+        }
+    }
+}
+
+void HighlightIndex::clear()
+{
+    m_firstLine = 0;
+    m_lineOffsets.clear();
+    m_spans.clear();
+}
+
+HighlightIndex::SpanRange HighlightIndex::spansForLine(int line) const
+{
+    const int index = line - m_firstLine;
+    if (index < 0 || index + 1 >= m_lineOffsets.size())
+    {
+        return SpanRange{nullptr, nullptr};
+    }
+    
+    const Span* data = m_spans.constData();
+    return SpanRange{data + m_lineOffsets[index], data + m_lineOffsets[index + 1]};
+}
+
+QByteArray HighlightIndex::toByteArray() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << qint32(m_firstLine) << qint32(m_lineOffsets.size()) << qint32(m_spans.size());
+    for (int offset : m_lineOffsets)
+    {
+        stream << qint32(offset);
+    }
+    for (const Span& span : m_spans)
+    {
+        stream << qint32(span.start) << qint32(span.end) << quint8(span.type);
+    }
+    return data;
+}
+
+bool HighlightIndex::fromByteArray(const QByteArray& data)
+{
+    clear();
+    
+    QDataStream stream(data);
+    qint32 firstLine;
+    qint32 offsetCount;
+    qint32 spanCount;
+    stream >> firstLine >> offsetCount >> spanCount;
+    // Each offset takes 4 bytes and each span 9, so a bad header can't make
+    // us allocate more than the data could hold
+    if (stream.status() != QDataStream::Ok || firstLine < 0 || offsetCount < 0 || spanCount < 0
+        || qint64(offsetCount) * 4 + qint64(spanCount) * 9 > data.size())
+    {
+        return false;
+    }
+    m_firstLine = firstLine;
+    
+    m_lineOffsets.resize(offsetCount);
+    for (int i = 0; i < offsetCount; ++i)
+    {
+        qint32 offset;
+        stream >> offset;
+        if (offset < (i > 0 ? m_lineOffsets[i - 1] : 0) || offset > spanCount)
+        {
+            clear();
+            return false;
+        }
+        m_lineOffsets[i] = offset;
+    }
+    
+    m_spans.resize(spanCount);
+    for (Span& span : m_spans)
+    {
+        qint32 start;
+        qint32 end;
+        quint8 type;
+        stream >> start >> end >> type;
+        if (type > quint8(HighlightType::None))
+        {
+            clear();
+            return false;
+        }
+        span = Span{start, end, HighlightType(type)};
+    }
+    
+    if (stream.status() != QDataStream::Ok || (offsetCount > 0 && m_lineOffsets.last() != spanCount))
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
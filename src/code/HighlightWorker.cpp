@@ -0,0 +1,193 @@
+#include "code/HighlightWorker.hpp"
+#include "code/HighlightCache.hpp"
+#include <QThreadPool>
+#include <QMutexLocker>
+
+using namespace openide;
+using namespace openide::code;
+
+HighlightWorker::HighlightWorker(QObject* parent)
+    : QObject(parent)
+    , m_running(false)
+    , m_stopping(false)
+    , m_hasText(false)
+    , m_fileType(FileType::UNKNOWN)
+    , m_revision(-1)
+    , m_rowsChanged(false)
+    , m_firstRow(-1)
+    , m_lastRow(-1)
+    , m_storeRevision(-1)
+    , m_treeRevision(-1)
+{
+    qRegisterMetaType<openide::code::HighlightResult>();
+}
+
+HighlightWorker::~HighlightWorker()
+{
+    // The running task uses m_treeWrapper and emits through this object, so
+    // wait for it to notice and finish
+    QMutexLocker locker(&m_mutex);
+    m_stopping = true;
+    m_hasText = false;
+    m_edits.clear();
+    m_rowsChanged = false;
+    m_storeKey.clear();
+    while (m_running)
+    {
+        m_idle.wait(&m_mutex);
+    }
+}
+
+void HighlightWorker::setText(const QString& text, FileType fileType, int revision)
+{
+    QMutexLocker locker(&m_mutex);
+    m_hasText = true;
+    m_text = text;
+    m_fileType = fileType;
+    m_edits.clear();
+    m_revision = revision;
+    if (revision > m_storeRevision)
+    {
+        m_storeKey.clear();
+    }
+    scheduleLocked();
+}
+
+void HighlightWorker::addEdit(int position, int charsRemoved, const QString& insertedText, int revision)
+{
+    QMutexLocker locker(&m_mutex);
+    m_edits.append(TextEdit{position, charsRemoved, insertedText});
+    m_revision = revision;
+    if (revision > m_storeRevision)
+    {
+        m_storeKey.clear();
+    }
+    scheduleLocked();
+}
+
+void HighlightWorker::setQueryRows(int firstRow, int lastRow)
+{
+    QMutexLocker locker(&m_mutex);
+    m_firstRow = firstRow;
+    m_lastRow = lastRow;
+    m_rowsChanged = true;
+    scheduleLocked();
+}
+
+void HighlightWorker::storeFullIndex(const QByteArray& key, int revision)
+{
+    QMutexLocker locker(&m_mutex);
+    if (key.isEmpty() || revision < m_revision)
+    {
+        return;
+    }
+    m_storeKey = key;
+    m_storeRevision = revision;
+    if (storeReadyLocked())
+    {
+        scheduleLocked();
+    }
+}
+
+bool HighlightWorker::storeReadyLocked() const
+{
+    return !m_storeKey.isEmpty() && m_storeRevision == m_treeRevision;
+}
+
+void HighlightWorker::storeFullIndexLocked(QMutexLocker<QMutex>& locker)
+{
+    if (m_stopping || !storeReadyLocked())
+    {
+        return;
+    }
+    const QByteArray key = m_storeKey;
+    m_storeKey.clear();
+    locker.unlock();
+    
+    // The next iteration restores the visible rows before querying again
+    m_treeWrapper.setQueryRows(-1, -1);
+    HighlightIndex index;
+    index.build(m_treeWrapper.highlight());
+    HighlightCache::store(key, index);
+    
+    locker.relock();
+}
+
+void HighlightWorker::scheduleLocked()
+{
+    // At most one task per document, so the wrapper is never shared between threads
+    if (m_running || m_stopping)
+    {
+        return;
+    }
+    m_running = true;
+    QThreadPool::globalInstance()->start([this](){ process(); });
+}
+
+void HighlightWorker::process()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_stopping && (m_hasText || !m_edits.isEmpty() || m_rowsChanged || storeReadyLocked()))
+    {
+        // Take everything queued so far and parse once for all of it
+        const bool hasText = m_hasText;
+        const QString text = m_text;
+        const FileType fileType = m_fileType;
+        const QVector<TextEdit> edits = m_edits;
+        const int revision = m_revision;
+        const int firstRow = m_firstRow;
+        const int lastRow = m_lastRow;
+        const bool rowsChanged = m_rowsChanged;
+        m_hasText = false;
+        m_text.clear();
+        m_edits.clear();
+        m_rowsChanged = false;
+        locker.unlock();
+        
+        HighlightResult result;
+        result.revision = revision;
+        result.fullParse = hasText;
+        result.firstRow = firstRow;
+        result.lastRow = lastRow;
+        m_treeWrapper.setQueryRows(firstRow, lastRow);
+        
+        // Only the visible rows moved: the tree is current, just query again
+        if (!hasText && edits.isEmpty())
+        {
+            if (rowsChanged && m_treeWrapper.hasSource())
+            {
+                result.index.build(m_treeWrapper.highlight(), firstRow, lastRow);
+                emit highlightsReady(result);
+            }
+            locker.relock();
+            storeFullIndexLocked(locker);
+            continue;
+        }
+        
+        bool applied = hasText ? m_treeWrapper.setText(text, fileType) : m_treeWrapper.hasSource();
+        for (const TextEdit& edit : edits)
+        {
+            if (!applied) break;
+            applied = m_treeWrapper.applyEdit(edit.position, edit.charsRemoved, edit.insertedText);
+        }
+        
+        if (applied)
+        {
+            result.index.build(m_treeWrapper.reparseAndHighlight(), firstRow, lastRow);
+            result.changedRows = m_treeWrapper.changedRows();
+        }
+        else
+        {
+            result.needsText = m_treeWrapper.isLanguageSupported(fileType) || !hasText;
+        }
+        
+        emit highlightsReady(result);
+        
+        locker.relock();
+        m_treeRevision = applied ? revision : -1;
+        storeFullIndexLocked(locker);
+    }
+    
+    m_running = false;
+    m_idle.wakeAll();
+}
@@ -0,0 +1,665 @@
+#include "code/LargeFileView.hpp"
+#include <QApplication>
+#include <QClipboard>
+#include <QCoreApplication>
+#include <QDir>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPointer>
+#include <QProgressBar>
+#include <QScrollBar>
+#include <QTemporaryFile>
+#include <QTextLayout>
+#include <QThreadPool>
+#include <QtMath>
+#include <climits>
+
+using namespace openide::code;
+
+namespace
+{
+bool isWordChar(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_');
+}
+
+// Whether text[index, index + length) is a whole word within text
+bool isWholeWord(const QString& text, int index, int length)
+{
+    const bool startOk = index == 0 || !isWordChar(text[index - 1]);
+    const bool endOk = index + length >= text.size() || !isWordChar(text[index + length]);
+    return startOk && endOk;
+}
+}
+
+LargeFileView::LargeFileView(QWidget* parent)
+    : QAbstractScrollArea(parent)
+    , m_progressBar{nullptr}
+    , m_cursor{0, 0}
+    , m_anchor{0, 0}
+    , m_isModified{false}
+    , m_isDetaching{false}
+    , m_isSavePending{false}
+    , m_revision{0}
+    , m_isDarkTheme{false}
+    , m_tabStopSpaces{4}
+    , m_maxLineWidth{0}
+{
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+
+    // Zero-interval timer: index one chunk per event loop pass
+    m_indexTimer.setInterval(0);
+    connect(&m_indexTimer, &QTimer::timeout, this, &LargeFileView::indexNextChunk);
+}
+
+LargeFileView::~LargeFileView()
+{
+    m_indexTimer.stop();
+}
+
+bool LargeFileView::openFile(const QString& path)
+{
+    m_indexTimer.stop();
+
+    auto mapping = std::make_shared<MappedFile>();
+    mapping->file.setFileName(path);
+    if (!mapping->file.open(QIODevice::ReadOnly)) return false;
+    const qint64 size = mapping->file.size();
+    if (size > 0) {
+        mapping->data = mapping->file.map(0, size);
+        if (!mapping->data) return false;
+    }
+
+    m_mapping = mapping;
+    m_buffer.setOriginal(reinterpret_cast<const char*>(m_mapping->data), size);
+    m_cursor = m_anchor = Position{0, 0};
+    m_maxLineWidth = 0;
+    // A copy still running is of the previous file and gets discarded, as
+    // does a save waiting for it
+    m_isDetaching = false;
+    m_isSavePending = false;
+    setModified(false);
+
+    // Line starts are found a chunk at a time, so the top of the file can be
+    // read while the rest is still being indexed. Editing waits for the index.
+    indexNextChunk();
+    if (!m_buffer.isIndexed()) {
+        showProgress(0, QStringLiteral("%p%"));
+        m_indexTimer.start();
+    }
+    return true;
+}
+
+void LargeFileView::showProgress(int percent, const QString& format)
+{
+    if (!m_progressBar) {
+        m_progressBar = new QProgressBar(this);
+        m_progressBar->setRange(0, 100);
+        m_progressBar->setTextVisible(true);
+    }
+    m_progressBar->setFormat(format);
+    m_progressBar->setValue(percent);
+    m_progressBar->setGeometry(QRect(width() - 200, 0, 200, 20));
+    m_progressBar->show();
+}
+
+bool LargeFileView::requestSave()
+{
+    if (m_isDetaching) {
+        m_isSavePending = true;
+        return false;
+    }
+    return true;
+}
+
+FileSaver::Writer LargeFileView::snapshotWriter()
+{
+    // Copying the table only copies the piece list; the buffers are shared.
+    // The mapping keeps the replaced file's contents alive after the save is
+    // committed, so the pieces stay valid.
+    PieceTable snapshot = m_buffer;
+    std::shared_ptr<MappedFile> mapping = m_mapping;
+    return [snapshot, mapping](QIODevice* device) {
+        return snapshot.write(device);
+    };
+}
+
+#ifdef Q_OS_WIN
+void LargeFileView::detachFromOriginal()
+{
+    if (m_isDetaching || !m_mapping || m_mapping->isCopy) return;
+
+    QTemporaryFile temporary(QDir::temp().filePath("openide-large-XXXXXX"));
+    temporary.setAutoRemove(false);
+    if (!temporary.open()) return;
+    const QString copyPath = temporary.fileName();
+    temporary.close();
+
+    // Copy from the mapping, which the task keeps alive, a chunk at a time
+    // so progress can be shown
+    m_isDetaching = true;
+    showProgress(0, QStringLiteral("Copying for save %p%"));
+    std::shared_ptr<MappedFile> original = m_mapping;
+    QPointer<LargeFileView> guard(this);
+    QThreadPool::globalInstance()->start([original, copyPath, guard]() {
+        const qint64 size = original->file.size();
+        QFile copy(copyPath);
+        bool copied = copy.open(QIODevice::WriteOnly);
+        for (qint64 pos = 0; copied && pos < size; pos += CopyChunkSize) {
+            const qint64 length = qMin(CopyChunkSize, size - pos);
+            copied = copy.write(reinterpret_cast<const char*>(original->data) + pos, length) == length;
+            const int percent = static_cast<int>((pos + length) * 100 / size);
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, original, percent]() {
+                if (guard && guard->m_isDetaching && guard->m_mapping == original) {
+                    guard->m_progressBar->setValue(percent);
+                }
+            }, Qt::QueuedConnection);
+        }
+        copy.close();
+
+        // The guard is only safe to check on the GUI thread, where the view lives
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, original, copyPath, copied]() {
+            if (guard && guard->m_isDetaching && guard->m_mapping == original) {
+                guard->onDetachFinished(copyPath, copied);
+            } else {
+                QFile::remove(copyPath);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LargeFileView::onDetachFinished(const QString& copyPath, bool copied)
+{
+    m_isDetaching = false;
+    m_progressBar->hide();
+
+    // The copy has the same bytes, so the pieces stay valid pointed at it.
+    // If it failed a save still runs and reports the error when committing.
+    auto mapping = std::make_shared<MappedFile>();
+    mapping->file.setFileName(copyPath);
+    mapping->isCopy = true;
+    const qint64 size = m_mapping->file.size();
+    if (copied && mapping->file.open(QIODevice::ReadOnly) && mapping->file.size() == size) {
+        mapping->data = size > 0 ? mapping->file.map(0, size) : nullptr;
+        if (mapping->data || size == 0) {
+            m_buffer.moveOriginal(reinterpret_cast<const char*>(mapping->data));
+            m_mapping = mapping;
+        }
+    }
+
+    if (m_isSavePending) {
+        m_isSavePending = false;
+        emit saveReady();
+    }
+}
+#endif
+
+void LargeFileView::setModified(bool isModified)
+{
+    if (m_isModified == isModified) return;
+    m_isModified = isModified;
+#ifdef Q_OS_WIN
+    // Windows can't rename over a file that is open and mapped, so the first
+    // edit starts moving the mapping to a copy, ready for when it is saved
+    if (isModified) {
+        detachFromOriginal();
+    }
+#endif
+    emit modificationChanged(isModified);
+}
+
+void LargeFileView::setDarkTheme(bool isDarkTheme)
+{
+    m_isDarkTheme = isDarkTheme;
+    viewport()->update();
+}
+
+void LargeFileView::setTabStopSpaces(int spaces)
+{
+    m_tabStopSpaces = spaces;
+    viewport()->update();
+}
+
+void LargeFileView::indexNextChunk()
+{
+    const bool done = m_buffer.indexStep(IndexChunkSize);
+    if (done) {
+        m_indexTimer.stop();
+        if (m_progressBar) {
+            m_progressBar->hide();
+        }
+    } else if (m_progressBar) {
+        m_progressBar->setValue(static_cast<int>(m_buffer.indexedBytes() * 100 / m_buffer.size()));
+    }
+    updateScrollBars();
+    viewport()->update();
+}
+
+QString LargeFileView::lineText(qint64 line) const
+{
+    const qint64 start = m_buffer.lineStart(line);
+    QByteArray bytes = m_buffer.read(start, qMin(m_buffer.lineLength(line), MaxLineBytes));
+    if (bytes.endsWith('\r')) {
+        bytes.chop(1);
+    }
+    return QString::fromUtf8(bytes);
+}
+
+void LargeFileView::layoutLine(QTextLayout& layout, const QString& text) const
+{
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    option.setTabStopDistance(QFontMetricsF(font()).horizontalAdvance(QLatin1Char(' ')) * m_tabStopSpaces);
+    layout.setText(text);
+    layout.setFont(font());
+    layout.setTextOption(option);
+    layout.beginLayout();
+    layout.createLine();
+    layout.endLayout();
+}
+
+qint64 LargeFileView::offsetOf(const Position& position) const
+{
+    const QString text = lineText(position.line);
+    return m_buffer.lineStart(position.line) + QStringView(text).left(position.column).toUtf8().size();
+}
+
+LargeFileView::Position LargeFileView::positionOf(qint64 offset) const
+{
+    const qint64 line = m_buffer.lineAt(offset);
+    const qint64 start = m_buffer.lineStart(line);
+    const int column = QString::fromUtf8(m_buffer.read(start, qMin(offset - start, MaxLineBytes))).size();
+    return Position{line, qMin(column, static_cast<int>(lineText(line).size()))};
+}
+
+LargeFileView::Position LargeFileView::positionAt(const QPoint& point) const
+{
+    const qint64 line = qBound<qint64>(0, verticalScrollBar()->value() + point.y() / lineHeight(), m_buffer.lineCount() - 1);
+    QTextLayout layout;
+    layoutLine(layout, lineText(line));
+    const int x = point.x() - textLeft() + horizontalScrollBar()->value();
+    return Position{line, layout.lineAt(0).xToCursor(x)};
+}
+
+void LargeFileView::moveCursorTo(const Position& position, bool keepAnchor)
+{
+    m_cursor = position;
+    if (!keepAnchor) {
+        m_anchor = position;
+    }
+    ensureCursorVisible();
+    viewport()->update();
+}
+
+void LargeFileView::moveCursor(QTextCursor::MoveOperation operation)
+{
+    if (operation == QTextCursor::Start) {
+        moveCursorTo(Position{0, 0}, false);
+    } else if (operation == QTextCursor::End) {
+        const qint64 last = m_buffer.lineCount() - 1;
+        moveCursorTo(Position{last, static_cast<int>(lineText(last).size())}, false);
+    }
+}
+
+QString LargeFileView::selectedText() const
+{
+    if (!hasSelection()) return QString();
+    const qint64 from = offsetOf(qMin(m_anchor, m_cursor));
+    const qint64 to = offsetOf(qMax(m_anchor, m_cursor));
+    return QString::fromUtf8(m_buffer.read(from, to - from));
+}
+
+bool LargeFileView::canEdit(const Position& from, const Position& to) const
+{
+    return m_buffer.isIndexed() && m_buffer.lineLength(from.line) <= MaxLineBytes
+           && m_buffer.lineLength(to.line) <= MaxLineBytes;
+}
+
+bool LargeFileView::insertText(const QString& text)
+{
+    if (!canEdit(qMin(m_anchor, m_cursor), qMax(m_anchor, m_cursor))) return false;
+    removeSelection();
+
+    const QByteArray bytes = text.toUtf8();
+    const qint64 offset = offsetOf(m_cursor);
+    m_buffer.insert(offset, bytes);
+    ++m_revision;
+    setModified(true);
+    updateScrollBars();
+    moveCursorTo(positionOf(offset + bytes.size()), false);
+    return true;
+}
+
+void LargeFileView::removeSelection()
+{
+    if (!hasSelection()) return;
+    const Position start = qMin(m_anchor, m_cursor);
+    removeRange(offsetOf(start), offsetOf(qMax(m_anchor, m_cursor)));
+    moveCursorTo(start, false);
+}
+
+void LargeFileView::removeRange(qint64 from, qint64 to)
+{
+    if (!m_buffer.isIndexed() || to <= from) return;
+    m_buffer.remove(from, to - from);
+    ++m_revision;
+    setModified(true);
+    updateScrollBars();
+}
+
+bool LargeFileView::find(const QString& text, QTextDocument::FindFlags flags)
+{
+    if (text.isEmpty()) return false;
+
+    const Qt::CaseSensitivity cs = (flags & QTextDocument::FindCaseSensitively) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    const bool wholeWords = flags & QTextDocument::FindWholeWords;
+    const bool backward = flags & QTextDocument::FindBackward;
+    const qint64 size = m_buffer.isIndexed() ? m_buffer.size() : m_buffer.indexedBytes();
+
+    // Search whole lines a chunk at a time, so a multi-GB file is decoded
+    // once rather than line by line
+    qint64 pos = offsetOf(backward ? qMin(m_anchor, m_cursor) : m_cursor);
+    while (backward ? pos > 0 : pos < size) {
+        qint64 from = backward ? qMax<qint64>(0, pos - SearchChunkSize) : pos;
+        qint64 to = backward ? pos : qMin(size, pos + SearchChunkSize);
+        QByteArray bytes = m_buffer.read(from, to - from);
+
+        // Trim to line boundaries, unless a single line fills the chunk
+        if (backward && from > 0) {
+            const int newline = bytes.indexOf('\n');
+            if (newline >= 0) {
+                bytes.remove(0, newline + 1);
+                from += newline + 1;
+            }
+        } else if (!backward && to < size) {
+            const int newline = bytes.lastIndexOf('\n');
+            if (newline >= 0) {
+                bytes.truncate(newline + 1);
+                to = from + newline + 1;
+            }
+        }
+
+        const QString chunk = QString::fromUtf8(bytes);
+        int index = backward ? chunk.lastIndexOf(text, -1, cs) : chunk.indexOf(text, 0, cs);
+        while (index >= 0 && wholeWords && !isWholeWord(chunk, index, text.size())) {
+            index = backward ? (index > 0 ? chunk.lastIndexOf(text, index - 1, cs) : -1)
+                             : chunk.indexOf(text, index + 1, cs);
+        }
+        if (index >= 0) {
+            const qint64 start = from + QStringView(chunk).left(index).toUtf8().size();
+            const qint64 end = start + QStringView(chunk).mid(index, text.size()).toUtf8().size();
+            m_anchor = positionOf(start);
+            moveCursorTo(positionOf(end), true);
+            return true;
+        }
+        pos = backward ? from : to;
+    }
+    return false;
+}
+
+int LargeFileView::lineHeight() const
+{
+    return qMax(1, fontMetrics().height());
+}
+
+int LargeFileView::visibleRows() const
+{
+    return qMax(1, viewport()->height() / lineHeight());
+}
+
+int LargeFileView::gutterWidth() const
+{
+    int digits = 1;
+    qint64 max = qMax<qint64>(1, m_buffer.lineCount());
+    while (max >= 10) {
+        max /= 10;
+        ++digits;
+    }
+    return 3 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+}
+
+int LargeFileView::textLeft() const
+{
+    // Same gap between gutter and text as QPlainTextEdit's document margin
+    return gutterWidth() + 4;
+}
+
+void LargeFileView::updateScrollBars()
+{
+    const qint64 lines = m_buffer.lineCount();
+    verticalScrollBar()->setRange(0, static_cast<int>(qMin<qint64>(INT_MAX, qMax<qint64>(0, lines - visibleRows()))));
+    verticalScrollBar()->setPageStep(visibleRows());
+    horizontalScrollBar()->setRange(0, qMax(0, m_maxLineWidth - (viewport()->width() - textLeft())));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+}
+
+void LargeFileView::ensureCursorVisible()
+{
+    const qint64 first = verticalScrollBar()->value();
+    if (m_cursor.line < first) {
+        verticalScrollBar()->setValue(static_cast<int>(m_cursor.line));
+    } else if (m_cursor.line >= first + visibleRows()) {
+        verticalScrollBar()->setValue(static_cast<int>(m_cursor.line - visibleRows() + 1));
+    }
+
+    QTextLayout layout;
+    layoutLine(layout, lineText(m_cursor.line));
+    const int x = qRound(layout.lineAt(0).cursorToX(m_cursor.column));
+    const int textWidth = viewport()->width() - textLeft();
+    m_maxLineWidth = qMax(m_maxLineWidth, x + 1);
+    updateScrollBars();
+    if (x < horizontalScrollBar()->value()) {
+        horizontalScrollBar()->setValue(x);
+    } else if (x >= horizontalScrollBar()->value() + textWidth) {
+        horizontalScrollBar()->setValue(x - textWidth + 1);
+    }
+}
+
+void LargeFileView::scrollContentsBy(int /* dx */, int /* dy */)
+{
+    viewport()->update();
+}
+
+void LargeFileView::resizeEvent(QResizeEvent* event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    if (m_progressBar) {
+        m_progressBar->setGeometry(QRect(width() - 200, 0, 200, 20));
+    }
+    updateScrollBars();
+}
+
+void LargeFileView::paintEvent(QPaintEvent* /* event */)
+{
+    QPainter painter(viewport());
+    const QPalette pal = palette();
+    painter.fillRect(viewport()->rect(), pal.color(QPalette::Base));
+
+    const int height = lineHeight();
+    const int left = textLeft();
+    const int hscroll = horizontalScrollBar()->value();
+    const qint64 first = verticalScrollBar()->value();
+    const qint64 last = qMin(m_buffer.lineCount() - 1, first + visibleRows());
+    const Position selStart = qMin(m_anchor, m_cursor);
+    const Position selEnd = qMax(m_anchor, m_cursor);
+    const int previousWidth = m_maxLineWidth;
+
+    // Text, clipped so horizontally scrolled lines don't run into the gutter
+    painter.save();
+    painter.setClipRect(QRect(gutterWidth(), 0, viewport()->width(), viewport()->height()));
+    for (qint64 line = first; line <= last; ++line) {
+        const int top = static_cast<int>(line - first) * height;
+        QTextLayout layout;
+        layoutLine(layout, lineText(line));
+        m_maxLineWidth = qMax(m_maxLineWidth, qCeil(layout.lineAt(0).naturalTextWidth()));
+
+        if (line == m_cursor.line) {
+            // Current-line highlight, same colors as CodeEditor
+            QColor lineColor = m_isDarkTheme ? QColor(255, 255, 255, 20) : QColor(0, 0, 0, 10);
+            painter.fillRect(QRect(0, top, viewport()->width(), height), lineColor);
+        }
+
+        QVector<QTextLayout::FormatRange> selections;
+        if (hasSelection() && line >= selStart.line && line <= selEnd.line) {
+            QTextLayout::FormatRange range;
+            range.start = line == selStart.line ? selStart.column : 0;
+            range.length = (line == selEnd.line ? selEnd.column : layout.text().size() + 1) - range.start;
+            range.format.setBackground(pal.color(QPalette::Highlight));
+            range.format.setForeground(pal.color(QPalette::HighlightedText));
+            selections.append(range);
+        }
+
+        painter.setPen(pal.color(QPalette::Text));
+        const QPointF origin(left - hscroll, top);
+        layout.draw(&painter, origin, selections);
+        if (line == m_cursor.line && hasFocus()) {
+            layout.drawCursor(&painter, origin, m_cursor.column);
+        }
+    }
+    painter.restore();
+
+    // Line number gutter, same colors as CodeEditor's LineNumberArea
+    const int gutter = gutterWidth();
+    painter.fillRect(QRect(0, 0, gutter, viewport()->height()),
+                     m_isDarkTheme ? QColor(45, 45, 45) : QColor(240, 240, 240));
+    painter.setPen(m_isDarkTheme ? QColor(170, 170, 170) : QColor(100, 100, 100));
+    for (qint64 line = first; line <= last; ++line) {
+        const int top = static_cast<int>(line - first) * height;
+        painter.drawText(0, top, gutter - 3, height, Qt::AlignRight, QString::number(line + 1));
+    }
+
+    if (m_maxLineWidth != previousWidth) {
+        updateScrollBars();
+    }
+}
+
+void LargeFileView::keyPressEvent(QKeyEvent* event)
+{
+    const bool shift = event->modifiers() & Qt::ShiftModifier;
+    const bool ctrl = event->modifiers() & Qt::ControlModifier;
+    const QString text = lineText(m_cursor.line);
+    const bool editable = canEdit(qMin(m_anchor, m_cursor), qMax(m_anchor, m_cursor));
+
+    if (event->matches(QKeySequence::Copy) || event->matches(QKeySequence::Cut)) {
+        // Like a read-only QPlainTextEdit, Cut does nothing where editing can't
+        const bool cut = event->matches(QKeySequence::Cut);
+        if (hasSelection() && (editable || !cut)) {
+            QApplication::clipboard()->setText(selectedText());
+            if (cut) {
+                removeSelection();
+            }
+        }
+        return;
+    }
+    if (event->matches(QKeySequence::Paste)) {
+        insertText(QApplication::clipboard()->text());
+        return;
+    }
+
+    QTextLayout layout;
+    layoutLine(layout, text);
+    const qint64 lastLine = m_buffer.lineCount() - 1;
+
+    switch (event->key()) {
+    case Qt::Key_Left:
+        if (m_cursor.column > 0) {
+            moveCursorTo(Position{m_cursor.line, layout.previousCursorPosition(m_cursor.column)}, shift);
+        } else if (m_cursor.line > 0) {
+            moveCursorTo(Position{m_cursor.line - 1, static_cast<int>(lineText(m_cursor.line - 1).size())}, shift);
+        }
+        return;
+    case Qt::Key_Right:
+        if (m_cursor.column < text.size()) {
+            moveCursorTo(Position{m_cursor.line, layout.nextCursorPosition(m_cursor.column)}, shift);
+        } else if (m_cursor.line < lastLine) {
+            moveCursorTo(Position{m_cursor.line + 1, 0}, shift);
+        }
+        return;
+    case Qt::Key_Up:
+    case Qt::Key_Down:
+    case Qt::Key_PageUp:
+    case Qt::Key_PageDown: {
+        const int step = (event->key() == Qt::Key_PageUp || event->key() == Qt::Key_PageDown) ? visibleRows() : 1;
+        const bool up = event->key() == Qt::Key_Up || event->key() == Qt::Key_PageUp;
+        const qint64 line = qBound<qint64>(0, m_cursor.line + (up ? -step : step), lastLine);
+        moveCursorTo(Position{line, qMin(m_cursor.column, static_cast<int>(lineText(line).size()))}, shift);
+        return;
+    }
+    case Qt::Key_Home:
+        moveCursorTo(ctrl ? Position{0, 0} : Position{m_cursor.line, 0}, shift);
+        return;
+    case Qt::Key_End:
+        if (ctrl) {
+            moveCursorTo(Position{lastLine, static_cast<int>(lineText(lastLine).size())}, shift);
+        } else {
+            moveCursorTo(Position{m_cursor.line, static_cast<int>(text.size())}, shift);
+        }
+        return;
+    case Qt::Key_Backspace:
+        if (!editable) {
+            return;
+        }
+        if (hasSelection()) {
+            removeSelection();
+        } else if (m_cursor.column > 0) {
+            const Position previous{m_cursor.line, layout.previousCursorPosition(m_cursor.column)};
+            removeRange(offsetOf(previous), offsetOf(m_cursor));
+            moveCursorTo(previous, false);
+        } else if (m_cursor.line > 0 && canEdit(Position{m_cursor.line - 1, 0}, m_cursor)) {
+            // Join with the previous line, dropping a CRLF as one line ending
+            const Position previous{m_cursor.line - 1, static_cast<int>(lineText(m_cursor.line - 1).size())};
+            removeRange(offsetOf(previous), m_buffer.lineStart(m_cursor.line));
+            moveCursorTo(previous, false);
+        }
+        return;
+    case Qt::Key_Delete:
+        if (!editable) {
+            return;
+        }
+        if (hasSelection()) {
+            removeSelection();
+        } else if (m_cursor.column < text.size()) {
+            const Position next{m_cursor.line, layout.nextCursorPosition(m_cursor.column)};
+            removeRange(offsetOf(m_cursor), offsetOf(next));
+            viewport()->update();
+        } else if (m_cursor.line < lastLine) {
+            removeRange(offsetOf(m_cursor), m_buffer.lineStart(m_cursor.line + 1));
+            viewport()->update();
+        }
+        return;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        insertText(QStringLiteral("\n"));
+        return;
+    case Qt::Key_Tab:
+        insertText(QStringLiteral("\t"));
+        return;
+    default:
+        break;
+    }
+
+    const QString input = event->text();
+    if (!ctrl && !input.isEmpty() && input.at(0).isPrint()) {
+        insertText(input);
+        return;
+    }
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void LargeFileView::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) {
+        moveCursorTo(positionAt(event->position().toPoint()), event->modifiers() & Qt::ShiftModifier);
+    }
+}
+
+void LargeFileView::mouseMoveEvent(QMouseEvent* event)
+{
+    if (event->buttons() & Qt::LeftButton) {
+        moveCursorTo(positionAt(event->position().toPoint()), true);
+    }
+}
@@ -0,0 +1,352 @@
+#include "code/PieceTable.hpp"
+#include <QIODevice>
+#include <algorithm>
+#include <cstring>
+
+using namespace openide::code;
+
+namespace
+{
+qint64 countNewlines(const char* data, qint64 length)
+{
+    return std::count(data, data + length, '\n');
+}
+}
+
+PieceTable::PieceTable()
+    : m_original(nullptr)
+    , m_originalSize(0)
+    , m_validPieces(0)
+    , m_size(0)
+    , m_newlines(0)
+    , m_indexedBytes(0)
+    , m_indexedNewlines(0)
+{
+}
+
+void PieceTable::setOriginal(const char* data, qint64 size)
+{
+    m_original = data;
+    m_originalSize = size;
+    m_added.clear();
+    m_pieces.clear();
+    if (size > 0)
+    {
+        // Its newline count is filled in once indexing finishes
+        m_pieces.append(Piece{false, 0, size, 0});
+    }
+    m_pieceStarts.fill(0, m_pieces.size());
+    m_pieceLines.fill(0, m_pieces.size());
+    m_validPieces = 0;
+    m_size = size;
+    m_newlines = 0;
+    m_checkpoints.clear();
+    m_indexedBytes = 0;
+    m_indexedNewlines = 0;
+}
+
+bool PieceTable::indexStep(qint64 maxBytes)
+{
+    const qint64 end = qMin(m_indexedBytes + maxBytes, m_originalSize);
+    const char* p = m_original + m_indexedBytes;
+    const char* last = m_original + end;
+    while (p < last)
+    {
+        p = static_cast<const char*>(std::memchr(p, '\n', last - p));
+        if (!p)
+        {
+            break;
+        }
+        if (m_indexedNewlines % CheckpointStride == 0)
+        {
+            m_checkpoints.append(p - m_original);
+        }
+        ++m_indexedNewlines;
+        ++p;
+    }
+    m_indexedBytes = end;
+
+    if (isIndexed() && m_newlines == 0 && m_pieces.size() == 1)
+    {
+        m_pieces[0].newlines = m_indexedNewlines;
+        m_newlines = m_indexedNewlines;
+    }
+    return isIndexed();
+}
+
+qint64 PieceTable::lineCount() const
+{
+    return (isIndexed() ? m_newlines : m_indexedNewlines) + 1;
+}
+
+qint64 PieceTable::lineStart(qint64 line) const
+{
+    if (line <= 0)
+    {
+        return 0;
+    }
+
+    // Line n starts after newline n - 1
+    qint64 n = line - 1;
+    if (!isIndexed())
+    {
+        // Nothing can be edited yet, so the document is the original
+        return n < m_indexedNewlines ? originalSelect(n) + 1 : m_indexedBytes;
+    }
+    if (n >= m_newlines)
+    {
+        return m_size;
+    }
+
+    const int i = pieceAtLine(n);
+    const Piece& piece = m_pieces[i];
+    n -= m_pieceLines[i];
+    qint64 offset;
+    if (piece.added)
+    {
+        const char* data = m_added.constData() + piece.start;
+        const char* p = data;
+        for (qint64 k = 0; k <= n; ++k)
+        {
+            p = static_cast<const char*>(std::memchr(p, '\n', data + piece.length - p)) + 1;
+        }
+        offset = p - data - 1;
+    }
+    else
+    {
+        offset = originalSelect(originalRank(piece.start) + n) - piece.start;
+    }
+    return m_pieceStarts[i] + offset + 1;
+}
+
+qint64 PieceTable::lineLength(qint64 line) const
+{
+    const qint64 start = lineStart(line);
+    if (line + 1 < lineCount())
+    {
+        return lineStart(line + 1) - 1 - start;
+    }
+    return (isIndexed() ? m_size : m_indexedBytes) - start;
+}
+
+qint64 PieceTable::lineAt(qint64 pos) const
+{
+    if (!isIndexed())
+    {
+        return originalRank(qBound<qint64>(0, pos, m_indexedBytes));
+    }
+    if (pos >= m_size)
+    {
+        return m_newlines;
+    }
+
+    const int i = pieceAt(pos);
+    const Piece& piece = m_pieces[i];
+    const qint64 length = pos - m_pieceStarts[i];
+    if (piece.added)
+    {
+        return m_pieceLines[i] + countNewlines(m_added.constData() + piece.start, length);
+    }
+    return m_pieceLines[i] + originalRank(piece.start + length) - originalRank(piece.start);
+}
+
+QByteArray PieceTable::read(qint64 pos, qint64 length) const
+{
+    QByteArray result;
+    pos = qBound<qint64>(0, pos, m_size);
+    length = qBound<qint64>(0, length, m_size - pos);
+    result.reserve(length);
+
+    int i = pieceAt(pos);
+    qint64 offset = i < m_pieces.size() ? pos - m_pieceStarts[i] : 0;
+    for (; length > 0 && i < m_pieces.size(); ++i)
+    {
+        const Piece& piece = m_pieces[i];
+        const qint64 count = qMin(piece.length - offset, length);
+        result.append(pieceData(piece) + offset, count);
+        length -= count;
+        offset = 0;
+    }
+    return result;
+}
+
+void PieceTable::insert(qint64 pos, const QByteArray& bytes)
+{
+    if (bytes.isEmpty() || !isIndexed())
+    {
+        return;
+    }
+    pos = qBound<qint64>(0, pos, m_size);
+    const qint64 newlines = countNewlines(bytes.constData(), bytes.size());
+
+    // Typing appends to the add buffer right after the previous insert, so
+    // grow that piece instead of adding one per keystroke
+    if (pos > 0)
+    {
+        const int i = pieceAt(pos - 1);
+        Piece& piece = m_pieces[i];
+        if (m_pieceStarts[i] + piece.length == pos && piece.added
+            && piece.start + piece.length == m_added.size())
+        {
+            m_added.append(bytes);
+            piece.length += bytes.size();
+            piece.newlines += newlines;
+            m_validPieces = qMin(m_validPieces, i + 1);
+            m_size += bytes.size();
+            m_newlines += newlines;
+            return;
+        }
+    }
+
+    const qint64 addStart = m_added.size();
+    m_added.append(bytes);
+    insertPiece(splitAt(pos), Piece{true, addStart, bytes.size(), newlines});
+    m_size += bytes.size();
+    m_newlines += newlines;
+}
+
+void PieceTable::remove(qint64 pos, qint64 length)
+{
+    if (!isIndexed())
+    {
+        return;
+    }
+    pos = qBound<qint64>(0, pos, m_size);
+    length = qBound<qint64>(0, length, m_size - pos);
+    if (length == 0)
+    {
+        return;
+    }
+
+    const int first = splitAt(pos);
+    const int last = splitAt(pos + length);
+    for (int i = first; i < last; ++i)
+    {
+        m_newlines -= m_pieces[i].newlines;
+    }
+    removePieces(first, last - first);
+    m_size -= length;
+}
+
+bool PieceTable::write(QIODevice* device) const
+{
+    for (const Piece& piece : m_pieces)
+    {
+        if (device->write(pieceData(piece), piece.length) != piece.length)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* PieceTable::pieceData(const Piece& piece) const
+{
+    return (piece.added ? m_added.constData() : m_original) + piece.start;
+}
+
+PieceTable::Piece PieceTable::makePiece(bool added, qint64 start, qint64 length) const
+{
+    Piece piece{added, start, length, 0};
+    if (added)
+    {
+        piece.newlines = countNewlines(m_added.constData() + start, length);
+    }
+    else
+    {
+        piece.newlines = originalRank(start + length) - originalRank(start);
+    }
+    return piece;
+}
+
+int PieceTable::splitAt(qint64 pos)
+{
+    const int i = pieceAt(pos);
+    if (i == m_pieces.size() || m_pieceStarts[i] == pos)
+    {
+        return i;
+    }
+    const Piece piece = m_pieces[i];
+    const qint64 offset = pos - m_pieceStarts[i];
+    m_pieces[i] = makePiece(piece.added, piece.start, offset);
+    insertPiece(i + 1, makePiece(piece.added, piece.start + offset, piece.length - offset));
+    return i + 1;
+}
+
+void PieceTable::insertPiece(int index, const Piece& piece)
+{
+    m_pieces.insert(index, piece);
+    m_pieceStarts.insert(index, 0);
+    m_pieceLines.insert(index, 0);
+    m_validPieces = qMin(m_validPieces, index);
+}
+
+void PieceTable::removePieces(int index, int count)
+{
+    m_pieces.remove(index, count);
+    m_pieceStarts.remove(index, count);
+    m_pieceLines.remove(index, count);
+    m_validPieces = qMin(m_validPieces, index);
+}
+
+int PieceTable::pieceAt(qint64 pos) const
+{
+    if (pos >= m_size)
+    {
+        return m_pieces.size();
+    }
+    // Extend the valid entries past pos, then search them
+    while (m_validPieces < m_pieces.size() && (m_validPieces == 0 || m_pieceStarts[m_validPieces - 1] <= pos))
+    {
+        updatePrefix(m_validPieces + 1);
+    }
+    auto it = std::upper_bound(m_pieceStarts.cbegin(), m_pieceStarts.cbegin() + m_validPieces, pos);
+    return static_cast<int>(it - m_pieceStarts.cbegin()) - 1;
+}
+
+int PieceTable::pieceAtLine(qint64 n) const
+{
+    if (n >= m_newlines)
+    {
+        return m_pieces.size();
+    }
+    while (m_validPieces < m_pieces.size() && (m_validPieces == 0 || m_pieceLines[m_validPieces - 1] <= n))
+    {
+        updatePrefix(m_validPieces + 1);
+    }
+    auto it = std::upper_bound(m_pieceLines.cbegin(), m_pieceLines.cbegin() + m_validPieces, n);
+    return static_cast<int>(it - m_pieceLines.cbegin()) - 1;
+}
+
+void PieceTable::updatePrefix(int count) const
+{
+    for (; m_validPieces < count; ++m_validPieces)
+    {
+        const int i = m_validPieces;
+        m_pieceStarts[i] = i == 0 ? 0 : m_pieceStarts[i - 1] + m_pieces[i - 1].length;
+        m_pieceLines[i] = i == 0 ? 0 : m_pieceLines[i - 1] + m_pieces[i - 1].newlines;
+    }
+}
+
+qint64 PieceTable::originalRank(qint64 offset) const
+{
+    // Start from the last checkpoint before offset and count the rest
+    auto it = std::lower_bound(m_checkpoints.begin(), m_checkpoints.end(), offset);
+    const qint64 k = (it - m_checkpoints.begin()) - 1;
+    if (k < 0)
+    {
+        return countNewlines(m_original, offset);
+    }
+    const qint64 from = m_checkpoints[k] + 1;
+    return k * CheckpointStride + 1 + countNewlines(m_original + from, offset - from);
+}
+
+qint64 PieceTable::originalSelect(qint64 n) const
+{
+    qint64 pos = m_checkpoints[n / CheckpointStride];
+    for (qint64 i = n % CheckpointStride; i > 0; --i)
+    {
+        pos = static_cast<const char*>(std::memchr(m_original + pos + 1, '\n', m_originalSize - pos - 1)) - m_original;
+    }
+    return pos;
+}
@@ -0,0 +1,282 @@
+#include "code/QueryRegistry.hpp"
+#include <tree_sitter/api.h>
+#include <QFile>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+
+// Declare external language functions from tree-sitter parsers
+extern "C" {
+    const TSLanguage *tree_sitter_c();
+    const TSLanguage *tree_sitter_cpp();
+    const TSLanguage *tree_sitter_python();
+    const TSLanguage *tree_sitter_java();
+    const TSLanguage *tree_sitter_javascript();
+    const TSLanguage *tree_sitter_typescript();
+    const TSLanguage *tree_sitter_go();
+    const TSLanguage *tree_sitter_rust();
+    const TSLanguage *tree_sitter_c_sharp();
+    const TSLanguage *tree_sitter_ruby();
+    const TSLanguage *tree_sitter_php();
+    const TSLanguage *tree_sitter_swift();
+    const TSLanguage *tree_sitter_kotlin();
+    const TSLanguage *tree_sitter_html();
+    const TSLanguage *tree_sitter_css();
+    // const TSLanguage *tree_sitter_sql();  // Skipped - no pre-generated parser
+    const TSLanguage *tree_sitter_bash();
+    const TSLanguage *tree_sitter_markdown();
+    const TSLanguage *tree_sitter_json();
+    const TSLanguage *tree_sitter_xml();
+    const TSLanguage *tree_sitter_yaml();
+}
+
+using namespace openide::code;
+using namespace openide;
+
+QueryRegistry& QueryRegistry::instance()
+{
+    static QueryRegistry registry;
+    return registry;
+}
+
+QueryRegistry::~QueryRegistry()
+{
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        if (it.value()->compiled)
+        {
+            ts_query_delete(it.value()->compiled->query);
+            delete it.value()->compiled;
+        }
+        delete it.value();
+    }
+    m_entries.clear();
+}
+
+const TSLanguage* QueryRegistry::language(FileType fileType)
+{
+    switch (fileType)
+    {
+        case FileType::C: return tree_sitter_c();
+        case FileType::CPP: return tree_sitter_cpp();
+        case FileType::PYTHON: return tree_sitter_python();
+        case FileType::JAVA: return tree_sitter_java();
+        case FileType::JAVASCRIPT: return tree_sitter_javascript();
+        case FileType::TYPESCRIPT: return tree_sitter_typescript();
+        case FileType::GO: return tree_sitter_go();
+        case FileType::RUST: return tree_sitter_rust();
+        case FileType::CSHARP: return tree_sitter_c_sharp();
+        case FileType::RUBY: return tree_sitter_ruby();
+        case FileType::PHP: return tree_sitter_php();
+        case FileType::SWIFT: return tree_sitter_swift();
+        case FileType::KOTLIN: return tree_sitter_kotlin();
+        case FileType::HTML: return tree_sitter_html();
+        case FileType::CSS: return tree_sitter_css();
+        case FileType::SQL: return nullptr;  // SQL parser not available (no pre-generated parser.c)
+        case FileType::SHELL: return tree_sitter_bash();
+        case FileType::MARKDOWN: return tree_sitter_markdown();
+        case FileType::JSON: return tree_sitter_json();
+        case FileType::XML: return tree_sitter_xml();
+        case FileType::YAML: return tree_sitter_yaml();
+        default: return nullptr;
+    }
+}
+
+QueryRegistry::Entry* QueryRegistry::entry(FileType fileType)
+{
+    QMutexLocker locker(&m_mutex);
+    Entry*& entry = m_entries[fileType];
+    if (!entry)
+    {
+        entry = new Entry;
+    }
+    return entry;
+}
+
+const CompiledQuery* QueryRegistry::highlightQuery(FileType fileType)
+{
+    // Each language has its own lock, so a worker waiting for one grammar
+    // isn't held up by another being compiled; a query is built exactly once
+    Entry* languageEntry = entry(fileType);
+    QMutexLocker locker(&languageEntry->mutex);
+    if (!languageEntry->resolved)
+    {
+        languageEntry->compiled = compile(fileType);
+        languageEntry->resolved = true;
+    }
+    return languageEntry->compiled;
+}
+
+void QueryRegistry::preload(FileType fileType)
+{
+    if (!language(fileType))
+    {
+        return;
+    }
+    
+    {
+        Entry* languageEntry = entry(fileType);
+        QMutexLocker locker(&languageEntry->mutex);
+        if (languageEntry->resolved)
+        {
+            return;
+        }
+    }
+    
+    QThreadPool::globalInstance()->start(QRunnable::create([fileType]()
+    {
+        QueryRegistry::instance().highlightQuery(fileType);
+    }));
+}
+
+CompiledQuery* QueryRegistry::compile(FileType fileType)
+{
+    const TSLanguage* lang = language(fileType);
+    if (!lang)
+    {
+        return nullptr;
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    
+    const QByteArray querySource = loadQuerySource(fileType);
+    if (querySource.isEmpty())
+    {
+        return nullptr;
+    }
+    const qint64 loadTime = timer.elapsed();
+    
+    uint32_t error_offset;
+    TSQueryError error_type;
+    TSQuery* query = ts_query_new(lang, querySource.constData(), querySource.size(), &error_offset, &error_type);
+    
+    if (!query || error_type != TSQueryErrorNone)
+    {
+        qDebug() << "Failed to compile highlight query for file type:" << static_cast<int>(fileType)
+                 << "at offset" << error_offset;
+        if (query)
+        {
+            ts_query_delete(query);
+        }
+        return nullptr;
+    }
+    
+    // Resolve every capture name once, so matching only indexes a table
+    CompiledQuery* compiled = new CompiledQuery;
+    compiled->query = query;
+    const uint32_t captureCount = ts_query_capture_count(query);
+    compiled->captureTypes.reserve(captureCount);
+    for (uint32_t id = 0; id < captureCount; id++)
+    {
+        uint32_t length;
+        const char* name = ts_query_capture_name_for_id(query, id, &length);
+        compiled->captureTypes.append(captureNameToHighlightType(QString::fromUtf8(name, length)));
+    }
+    
+    // Grammars carry no version number; a regenerated parser changes its
+    // symbol, state or field counts
+    QCryptographicHash fingerprint(QCryptographicHash::Sha1);
+    fingerprint.addData(querySource);
+    fingerprint.addData(QByteArray::number(ts_language_symbol_count(lang)) + ':'
+                        + QByteArray::number(ts_language_state_count(lang)) + ':'
+                        + QByteArray::number(ts_language_field_count(lang)));
+    compiled->fingerprint = fingerprint.result();
+    
+    qDebug() << "Compiled highlight query for file type:" << static_cast<int>(fileType)
+             << "load" << loadTime << "ms, total" << timer.elapsed() << "ms";
+    return compiled;
+}
+
+QByteArray QueryRegistry::loadQuerySource(FileType fileType)
+{
+    // Queries are compiled into the core library as Qt resources, under the
+    // same paths they have in external/
+    QString resourcePath;
+    switch (fileType)
+    {
+        case FileType::C: resourcePath = "tree-sitter-c/queries/highlights.scm"; break;
+        case FileType::CPP: resourcePath = "tree-sitter-cpp/queries/highlights.scm"; break;
+        case FileType::PYTHON: resourcePath = "tree-sitter-python/queries/highlights.scm"; break;
+        case FileType::JAVA: resourcePath = "tree-sitter-java/queries/highlights.scm"; break;
+        case FileType::JAVASCRIPT: resourcePath = "tree-sitter-javascript/queries/highlights.scm"; break;
+        case FileType::TYPESCRIPT: resourcePath = "tree-sitter-typescript/queries/highlights.scm"; break;
+        case FileType::GO: resourcePath = "tree-sitter-go/queries/highlights.scm"; break;
+        case FileType::RUST: resourcePath = "tree-sitter-rust/queries/highlights.scm"; break;
+        case FileType::CSHARP: resourcePath = "tree-sitter-c-sharp/queries/highlights.scm"; break;
+        case FileType::RUBY: resourcePath = "tree-sitter-ruby/queries/highlights.scm"; break;
+        case FileType::PHP: resourcePath = "tree-sitter-php/queries/highlights.scm"; break;
+        case FileType::SWIFT: resourcePath = "tree-sitter-swift/queries/highlights.scm"; break;
+        case FileType::KOTLIN: resourcePath = "tree-sitter-kotlin/queries/highlights.scm"; break;
+        case FileType::HTML: resourcePath = "tree-sitter-html/queries/highlights.scm"; break;
+        case FileType::CSS: resourcePath = "tree-sitter-css/queries/highlights.scm"; break;
+        case FileType::SHELL: resourcePath = "tree-sitter-bash/queries/highlights.scm"; break;
+        case FileType::MARKDOWN: resourcePath = "tree-sitter-markdown/tree-sitter-markdown/queries/highlights.scm"; break;
+        case FileType::JSON: resourcePath = "tree-sitter-json/queries/highlights.scm"; break;
+        case FileType::XML: resourcePath = "tree-sitter-xml/queries/highlights.scm"; break;
+        case FileType::YAML: resourcePath = "tree-sitter-yaml/queries/highlights.scm"; break;
+        default:
+            qDebug() << "No query file mapped for file type:" << static_cast<int>(fileType);
+            return QByteArray();
+    }
+    
+    QFile file(":/queries/" + resourcePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "Failed to open query resource:" << file.fileName();
+        return QByteArray();
+    }
+    QByteArray content = file.readAll();
+    
+    // Append additional queries for specific languages to augment the official .scm
+    if (fileType == FileType::CPP || fileType == FileType::C)
+    {
+        // Add essential missing patterns from C/C++ that aren't in the .scm
+        content.append("\n; Additional essential patterns\n");
+        content.append("(string_literal) @string\n");
+        content.append("(system_lib_string) @string\n");
+        content.append("(char_literal) @string\n");
+        content.append("(number_literal) @number\n");
+        content.append("(comment) @comment\n");
+        content.append("(true) @constant\n");
+        content.append("(false) @constant\n");
+        content.append("(type_identifier) @type\n");
+        content.append("(primitive_type) @type\n");
+        content.append("(sized_type_specifier) @type\n");
+        content.append("(call_expression function: (identifier) @function)\n");
+    }
+    
+    return content;
+}
+
+HighlightType QueryRegistry::captureNameToHighlightType(const QString& captureName)
+{
+    // Dotted names fall back to their parent (function.method -> function),
+    // unless the more specific name has its own mapping
+    if (captureName == "variable.parameter") return HighlightType::Parameter;
+    const int dot = captureName.lastIndexOf('.');
+    if (dot > 0)
+    {
+        HighlightType type = captureNameToHighlightType(captureName.left(dot));
+        if (type != HighlightType::None) return type;
+    }
+    
+    if (captureName == "keyword") return HighlightType::Keyword;
+    if (captureName == "comment") return HighlightType::Comment;
+    if (captureName == "string") return HighlightType::String;
+    if (captureName == "number") return HighlightType::Number;
+    if (captureName == "function") return HighlightType::Function;
+    if (captureName == "class") return HighlightType::Class;
+    if (captureName == "type") return HighlightType::Type;
+    if (captureName == "variable") return HighlightType::Variable;
+    if (captureName == "operator") return HighlightType::Operator;
+    if (captureName == "punctuation") return HighlightType::Punctuation;
+    if (captureName == "property") return HighlightType::Property;
+    if (captureName == "parameter") return HighlightType::Parameter;
+    if (captureName == "constant") return HighlightType::Constant;
+    
+    return HighlightType::None;
+}
@@ -1,89 +1,328 @@
 #include "code/SyntaxHighlighter.hpp"
+#include <QTextBlock>
+#include <QTimer>
+#include <climits>
 
 using namespace openide;
 using namespace openide::code;
 
 SyntaxHighlighter::SyntaxHighlighter(QTextDocument* parent) 
-    : QSyntaxHighlighter(parent)
-    , m_treeWrapper(new TreeSitterWrapper())
+    : QSyntaxHighlighter(static_cast<QObject*>(parent))
+    , m_worker(new HighlightWorker())
     , m_colorScheme(new ColorScheme())
     , m_fileType(FileType::UNKNOWN)
     , m_isDarkTheme(false)
+    , m_documentRevision(0)
+    , m_workerLength(0)
+    , m_snapshotPending(false)
+    , m_visibleFirstRow(0)
+    , m_visibleLastRow(0)
+    , m_queryFirstRow(-1)
+    , m_queryLastRow(-1)
+    , m_indexFirstRow(0)
+    , m_indexLastRow(-1)
+    , m_hasCachedIndex(false)
+    , m_cachedPaintRow(0)
 {
+    // Forward edits before QSyntaxHighlighter re-highlights the changed blocks,
+    // so connect first and only then attach the document
+    connect(parent, &QTextDocument::contentsChange, this, [this](int position, int charsRemoved, int charsAdded){
+        onContentsChange(position, charsRemoved, charsAdded);
+    });
+    setDocument(parent);
+    
+    // Results are emitted from a pool thread and queued onto the GUI thread
+    connect(m_worker, &HighlightWorker::highlightsReady, this, [this](const HighlightResult& result){
+        onHighlightsReady(result);
+    });
 }
 
 SyntaxHighlighter::~SyntaxHighlighter()
 {
-    delete m_treeWrapper;
+    delete m_worker;
     delete m_colorScheme;
 }
 
 void SyntaxHighlighter::setFileType(FileType fileType)
 {
     m_fileType = fileType;
-    m_cachedHighlights.clear();
-    m_lastParsedText.clear();
+    m_highlightIndex.clear();
+    m_indexFirstRow = 0;
+    m_indexLastRow = -1;
+    m_editedRanges.clear();
+    clearCachedHighlights();
+    updateQueryRows(true);
+    requestSnapshot();
 }
 
-void SyntaxHighlighter::updateTheme(bool isDarkTheme)
+void SyntaxHighlighter::setVisibleRows(int firstRow, int lastRow)
 {
-    m_isDarkTheme = isDarkTheme;
-    m_colorScheme->updateTheme(isDarkTheme);
+    m_visibleFirstRow = firstRow;
+    m_visibleLastRow = lastRow;
+    updateQueryRows(false);
 }
 
-void SyntaxHighlighter::rehighlight()
+void SyntaxHighlighter::setCachedHighlights(const HighlightIndex& index)
 {
-    // Clear cache to force re-parsing
-    m_cachedHighlights.clear();
-    m_lastParsedText.clear();
-    QSyntaxHighlighter::rehighlight();
+    if (!TreeSitterWrapper::isLanguageSupported(m_fileType))
+    {
+        return;
+    }
+    m_cachedIndex = index;
+    m_hasCachedIndex = true;
+    
+    // What is on screen first, then the rest of the file in the background
+    QTextBlock block = document()->findBlockByNumber(m_visibleFirstRow);
+    for (int row = m_visibleFirstRow; block.isValid() && row <= m_visibleLastRow; ++row)
+    {
+        rehighlightBlock(block);
+        block = block.next();
+    }
+    m_cachedPaintRow = 0;
+    QTimer::singleShot(0, this, [this](){ paintCachedRows(); });
 }
 
-void SyntaxHighlighter::highlightBlock(const QString& text)
+void SyntaxHighlighter::paintCachedRows()
 {
-    if (m_fileType == FileType::UNKNOWN || !m_treeWrapper->isLanguageSupported(m_fileType))
+    // Stopped by an edit or a newer file type
+    if (!m_hasCachedIndex)
     {
         return;
     }
     
-    // Get the full document text
-    QString documentText = document()->toPlainText();
+    QTextBlock block = document()->findBlockByNumber(m_cachedPaintRow);
+    const int lastRow = m_cachedPaintRow + CachedPaintBatchRows;
+    for (; block.isValid() && m_cachedPaintRow < lastRow; ++m_cachedPaintRow)
+    {
+        // Rows inside the worker's index already show fresh highlights
+        if (m_cachedPaintRow < m_indexFirstRow || m_cachedPaintRow > m_indexLastRow)
+        {
+            rehighlightBlock(block);
+        }
+        block = block.next();
+    }
+    if (block.isValid())
+    {
+        QTimer::singleShot(0, this, [this](){ paintCachedRows(); });
+    }
+}
+
+void SyntaxHighlighter::clearCachedHighlights()
+{
+    m_cachedIndex.clear();
+    m_hasCachedIndex = false;
+}
+
+void SyntaxHighlighter::storeInCache(const QByteArray& key)
+{
+    if (TreeSitterWrapper::isLanguageSupported(m_fileType))
+    {
+        m_worker->storeFullIndex(key, m_documentRevision);
+    }
+}
+
+void SyntaxHighlighter::updateQueryRows(bool force)
+{
+    // Still inside the queried rows, nothing new to fetch
+    if (!force && m_visibleFirstRow >= m_queryFirstRow && m_visibleLastRow <= m_queryLastRow)
+    {
+        return;
+    }
     
-    // Only re-parse if the document has changed
-    if (documentText != m_lastParsedText)
+    m_queryFirstRow = qMax(0, m_visibleFirstRow - ViewportMarginRows);
+    m_queryLastRow = m_visibleLastRow + ViewportMarginRows;
+    m_worker->setQueryRows(m_queryFirstRow, m_queryLastRow);
+}
+
+void SyntaxHighlighter::requestSnapshot()
+{
+    // Deferred so a setFileType() followed by setPlainText() sends the text once
+    if (m_snapshotPending)
     {
-        m_lastParsedText = documentText;
-        m_cachedHighlights = m_treeWrapper->parseAndHighlight(documentText, m_fileType);
+        return;
+    }
+    m_snapshotPending = true;
+    QTimer::singleShot(0, this, [this](){ sendSnapshot(); });
+}
+
+void SyntaxHighlighter::sendSnapshot()
+{
+    m_snapshotPending = false;
+    if (!TreeSitterWrapper::isLanguageSupported(m_fileType))
+    {
+        return;
     }
     
-    // Get the position of the current block in the document
-    int blockStart = currentBlock().position();
-    int blockLength = currentBlock().length();
+    QString text = document()->toPlainText();
+    m_workerLength = text.length();
+    m_worker->setText(text, m_fileType, m_documentRevision);
+}
+
+void SyntaxHighlighter::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    m_documentRevision++;
+    
+    // Cached rows no longer line up with the text
+    clearCachedHighlights();
     
-    // Apply highlights for this block
-    for (const HighlightInfo& info : m_cachedHighlights)
+    // The pending snapshot will include this edit
+    if (m_snapshotPending || !TreeSitterWrapper::isLanguageSupported(m_fileType))
     {
-        // Check if this highlight overlaps with the current block
-        int highlightStart = info.start;
-        int highlightEnd = info.start + info.length;
-        int blockEnd = blockStart + blockLength;
-        
-        // Skip highlights that don't overlap with this block
-        if (highlightEnd <= blockStart || highlightStart >= blockEnd)
+        return;
+    }
+    
+    // QTextDocument can report one character past the end (e.g. on setPlainText);
+    // resend the whole text rather than an edit the worker can't map
+    if (position + charsRemoved > m_workerLength)
+    {
+        requestSnapshot();
+        return;
+    }
+    
+    int end = qMin(position + charsAdded, document()->characterCount() - 1);
+    QTextCursor cursor(document());
+    cursor.setPosition(position);
+    cursor.setPosition(qMax(position, end), QTextCursor::KeepAnchor);
+    QString insertedText = cursor.selectedText();
+    
+    // Match the separators toPlainText() produces
+    insertedText.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    insertedText.replace(QChar::LineSeparator, QLatin1Char('\n'));
+    insertedText.replace(QChar::Nbsp, QLatin1Char(' '));
+    
+    m_workerLength += insertedText.length() - charsRemoved;
+    m_worker->addEdit(position, charsRemoved, insertedText, m_documentRevision);
+    
+    // The edited blocks are highlighted right away from the previous result;
+    // remember them (the cursor follows later edits) to repaint when fresh
+    // highlights arrive
+    m_editedRanges.append(cursor);
+}
+
+void SyntaxHighlighter::onHighlightsReady(const HighlightResult& result)
+{
+    if (result.needsText)
+    {
+        requestSnapshot();
+        return;
+    }
+    
+    // Stale: a newer revision is already queued, keep showing the old highlights.
+    // The worker's next changed rows are relative to this result's tree, so
+    // keep its changed rows to repaint along with the next accepted result.
+    if (result.revision != m_documentRevision || m_snapshotPending)
+    {
+        if (result.fullParse)
         {
-            continue;
+            QTextCursor cursor(document());
+            cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+            m_editedRanges.append(cursor);
         }
-        
-        // Calculate the position and length within the current block
-        int formatStart = qMax(0, highlightStart - blockStart);
-        int formatEnd = qMin(blockLength, highlightEnd - blockStart);
+        for (const RowRange& range : result.changedRows)
+        {
+            const QTextBlock first = document()->findBlockByNumber(range.first);
+            if (!first.isValid())
+            {
+                continue;
+            }
+            QTextCursor cursor(first);
+            QTextBlock last = document()->findBlockByNumber(range.last);
+            if (!last.isValid())
+            {
+                last = document()->lastBlock();
+            }
+            cursor.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+            m_editedRanges.append(cursor);
+        }
+        return;
+    }
+    
+    const int oldFirstRow = m_indexFirstRow;
+    const int oldLastRow = m_indexLastRow;
+    m_highlightIndex = result.index;
+    m_indexFirstRow = result.firstRow < 0 ? 0 : result.firstRow;
+    m_indexLastRow = result.firstRow < 0 ? INT_MAX : result.lastRow;
+    
+    if (result.fullParse || oldLastRow < oldFirstRow)
+    {
+        m_editedRanges.clear();
+        rehighlightRows(m_indexFirstRow, m_indexLastRow);
+        return;
+    }
+    
+    // Rows that just came into range were painted without highlights
+    if (m_indexFirstRow < oldFirstRow)
+    {
+        rehighlightRows(m_indexFirstRow, qMin(m_indexLastRow, oldFirstRow - 1));
+    }
+    if (m_indexLastRow > oldLastRow)
+    {
+        rehighlightRows(qMax(m_indexFirstRow, oldLastRow + 1), m_indexLastRow);
+    }
+    
+    // Repaint only the edited blocks and the rows tree-sitter reports as changed
+    const QVector<QTextCursor> editedRanges = m_editedRanges;
+    m_editedRanges.clear();
+    for (const QTextCursor& range : editedRanges)
+    {
+        rehighlightRows(document()->findBlock(range.selectionStart()).blockNumber(),
+                        document()->findBlock(range.selectionEnd()).blockNumber());
+    }
+    for (const RowRange& range : result.changedRows)
+    {
+        rehighlightRows(range.first, range.last);
+    }
+}
+
+void SyntaxHighlighter::rehighlightRows(int firstRow, int lastRow)
+{
+    // Rows outside the index are repainted when they come into range
+    firstRow = qMax(firstRow, m_indexFirstRow);
+    lastRow = qMin(lastRow, m_indexLastRow);
+    
+    QTextBlock block = document()->findBlockByNumber(firstRow);
+    for (int row = firstRow; block.isValid() && row <= lastRow; ++row)
+    {
+        rehighlightBlock(block);
+        block = block.next();
+    }
+}
+
+void SyntaxHighlighter::updateTheme(bool isDarkTheme)
+{
+    m_isDarkTheme = isDarkTheme;
+    m_colorScheme->updateTheme(isDarkTheme);
+}
+
+void SyntaxHighlighter::rehighlight()
+{
+    // Cached highlights stay valid for the current revision, so this only
+    // re-applies formats (e.g. after a theme change)
+    QSyntaxHighlighter::rehighlight();
+}
+
+void SyntaxHighlighter::highlightBlock(const QString& text)
+{
+    if (m_fileType == FileType::UNKNOWN || !TreeSitterWrapper::isLanguageSupported(m_fileType))
+    {
+        return;
+    }
+    
+    // Never parses here: the index is whatever the worker last delivered, or
+    // the cached highlights for rows it doesn't cover yet
+    int blockLength = currentBlock().length();
+    int row = currentBlock().blockNumber();
+    const bool useCache = m_hasCachedIndex && (row < m_indexFirstRow || row > m_indexLastRow);
+    for (const HighlightIndex::Span& span : (useCache ? m_cachedIndex : m_highlightIndex).spansForLine(row))
+    {
+        int formatStart = qMax(0, span.start);
+        int formatEnd = span.end < 0 ? blockLength : qMin(blockLength, span.end);
         int formatLength = formatEnd - formatStart;
         
         if (formatLength > 0)
         {
-            QTextCharFormat format = m_colorScheme->getFormatForType(info.type);
+            QTextCharFormat format = m_colorScheme->getFormatForType(span.type);
             setFormat(formatStart, formatLength, format);
         }
     }
 }
-
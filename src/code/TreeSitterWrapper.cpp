@@ -1,56 +1,52 @@
 #include "code/TreeSitterWrapper.hpp"
+#include "code/QueryRegistry.hpp"
 #include <tree_sitter/api.h>
-#include <QFile>
-#include <QDir>
-#include <QCoreApplication>
-#include <QHash>
-#include <QDebug>
-
-// Declare external language functions from tree-sitter parsers
-extern "C" {
-    const TSLanguage *tree_sitter_c();
-    const TSLanguage *tree_sitter_cpp();
-    const TSLanguage *tree_sitter_python();
-    const TSLanguage *tree_sitter_java();
-    const TSLanguage *tree_sitter_javascript();
-    const TSLanguage *tree_sitter_typescript();
-    const TSLanguage *tree_sitter_go();
-    const TSLanguage *tree_sitter_rust();
-    const TSLanguage *tree_sitter_c_sharp();
-    const TSLanguage *tree_sitter_ruby();
-    const TSLanguage *tree_sitter_php();
-    const TSLanguage *tree_sitter_swift();
-    const TSLanguage *tree_sitter_kotlin();
-    const TSLanguage *tree_sitter_html();
-    const TSLanguage *tree_sitter_css();
-    // const TSLanguage *tree_sitter_sql();  // Skipped - no pre-generated parser
-    const TSLanguage *tree_sitter_bash();
-    const TSLanguage *tree_sitter_markdown();
-    const TSLanguage *tree_sitter_json();
-    const TSLanguage *tree_sitter_xml();
-    const TSLanguage *tree_sitter_yaml();
-}
+#include <cstdlib>
+#include <algorithm>
 
 using namespace openide::code;
 using namespace openide;
 
+namespace
+{
+// QString stores host-endian UTF-16, which tree-sitter parses directly.
+// Byte offsets and point columns are then exactly twice the QString offsets.
+#if TREE_SITTER_LANGUAGE_VERSION >= 15
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+const TSInputEncoding Utf16Encoding = TSInputEncodingUTF16BE;
+#else
+const TSInputEncoding Utf16Encoding = TSInputEncodingUTF16LE;
+#endif
+#else
+const TSInputEncoding Utf16Encoding = TSInputEncodingUTF16;
+#endif
+const int BytesPerChar = 2;
+
+// Append text to chunks in pieces of at most chunkChars, skipping empty ones
+void appendChunks(QVector<QString>& chunks, const QString& text, int chunkChars)
+{
+    for (int i = 0; i < text.size(); i += chunkChars)
+    {
+        chunks.append(text.mid(i, chunkChars));
+    }
+}
+}
+
 TreeSitterWrapper::TreeSitterWrapper()
     : m_parser(nullptr)
+    , m_tree(nullptr)
+    , m_treeFileType(FileType::UNKNOWN)
+    , m_sourceSize(0)
+    , m_hasSource(false)
+    , m_queryFirstRow(-1)
+    , m_queryLastRow(-1)
 {
     m_parser = ts_parser_new();
 }
 
 TreeSitterWrapper::~TreeSitterWrapper()
 {
-    // Clean up queries
-    for (auto it = m_queries.begin(); it != m_queries.end(); ++it)
-    {
-        if (it.value())
-        {
-            ts_query_delete(it.value());
-        }
-    }
-    m_queries.clear();
+    reset();
     
     // Clean up parser
     if (m_parser)
@@ -59,214 +55,286 @@ TreeSitterWrapper::~TreeSitterWrapper()
     }
 }
 
-const TSLanguage* TreeSitterWrapper::getLanguage(FileType fileType) const
+bool TreeSitterWrapper::isLanguageSupported(FileType fileType)
 {
-    switch (fileType)
-    {
-        case FileType::C: return tree_sitter_c();
-        case FileType::CPP: return tree_sitter_cpp();
-        case FileType::PYTHON: return tree_sitter_python();
-        case FileType::JAVA: return tree_sitter_java();
-        case FileType::JAVASCRIPT: return tree_sitter_javascript();
-        case FileType::TYPESCRIPT: return tree_sitter_typescript();
-        case FileType::GO: return tree_sitter_go();
-        case FileType::RUST: return tree_sitter_rust();
-        case FileType::CSHARP: return tree_sitter_c_sharp();
-        case FileType::RUBY: return tree_sitter_ruby();
-        case FileType::PHP: return tree_sitter_php();
-        case FileType::SWIFT: return tree_sitter_swift();
-        case FileType::KOTLIN: return tree_sitter_kotlin();
-        case FileType::HTML: return tree_sitter_html();
-        case FileType::CSS: return tree_sitter_css();
-        case FileType::SQL: return nullptr;  // SQL parser not available (no pre-generated parser.c)
-        case FileType::SHELL: return tree_sitter_bash();
-        case FileType::MARKDOWN: return tree_sitter_markdown();
-        case FileType::JSON: return tree_sitter_json();
-        case FileType::XML: return tree_sitter_xml();
-        case FileType::YAML: return tree_sitter_yaml();
-        default: return nullptr;
-    }
+    return QueryRegistry::language(fileType) != nullptr;
 }
 
-bool TreeSitterWrapper::isLanguageSupported(FileType fileType) const
+QVector<HighlightInfo> TreeSitterWrapper::parseAndHighlight(const QString& text, FileType fileType)
 {
-    return getLanguage(fileType) != nullptr;
+    if (!setText(text, fileType))
+    {
+        return QVector<HighlightInfo>();
+    }
+    return reparseAndHighlight();
 }
 
-const char* TreeSitterWrapper::getQueryPatterns(FileType fileType) const
+bool TreeSitterWrapper::setText(const QString& text, FileType fileType)
 {
-    // Map file types to their highlight query file paths
-    static QHash<FileType, QString> queryFiles;
-    static QHash<FileType, QByteArray> cachedQueries;
+    reset();
     
-    if (queryFiles.isEmpty()) {
-        // Traverse up the directory tree to find the "openIDE" project root
-        QString appDir = QCoreApplication::applicationDirPath();
-        QDir dir(appDir);
-        
-        // Keep going up until we find "openIDE" directory or reach the root
-        bool foundProjectRoot = false;
-        int maxAttempts = 20; // Safety limit to prevent infinite loop
-        int attempts = 0;
-        
-        while (attempts < maxAttempts) {
-            if (dir.dirName().toLower() == "openide") {
-                foundProjectRoot = true;
-                qDebug() << "Found openIDE project root at:" << dir.absolutePath();
-                break;
-            }
-            
-            if (!dir.cdUp()) {
-                // Reached root without finding openIDE
-                qDebug() << "Could not find openIDE directory, reached filesystem root";
-                break;
-            }
-            attempts++;
-        }
-        
-        if (!foundProjectRoot) {
-            qDebug() << "Warning: Could not locate openIDE project root directory";
-        }
-        
-        QString baseDir = dir.absolutePath() + "/external/";
-        
-        queryFiles[FileType::C] = baseDir + "tree-sitter-c/queries/highlights.scm";
-        queryFiles[FileType::CPP] = baseDir + "tree-sitter-cpp/queries/highlights.scm";
-        queryFiles[FileType::PYTHON] = baseDir + "tree-sitter-python/queries/highlights.scm";
-        queryFiles[FileType::JAVA] = baseDir + "tree-sitter-java/queries/highlights.scm";
-        queryFiles[FileType::JAVASCRIPT] = baseDir + "tree-sitter-javascript/queries/highlights.scm";
-        queryFiles[FileType::TYPESCRIPT] = baseDir + "tree-sitter-typescript/queries/highlights.scm";
-        queryFiles[FileType::GO] = baseDir + "tree-sitter-go/queries/highlights.scm";
-        queryFiles[FileType::RUST] = baseDir + "tree-sitter-rust/queries/highlights.scm";
-        queryFiles[FileType::CSHARP] = baseDir + "tree-sitter-c-sharp/queries/highlights.scm";
-        queryFiles[FileType::RUBY] = baseDir + "tree-sitter-ruby/queries/highlights.scm";
-        queryFiles[FileType::PHP] = baseDir + "tree-sitter-php/queries/highlights.scm";
-        queryFiles[FileType::SWIFT] = baseDir + "tree-sitter-swift/queries/highlights.scm";
-        queryFiles[FileType::KOTLIN] = baseDir + "tree-sitter-kotlin/queries/highlights.scm";
-        queryFiles[FileType::HTML] = baseDir + "tree-sitter-html/queries/highlights.scm";
-        queryFiles[FileType::CSS] = baseDir + "tree-sitter-css/queries/highlights.scm";
-        queryFiles[FileType::SHELL] = baseDir + "tree-sitter-bash/queries/highlights.scm";
-        queryFiles[FileType::MARKDOWN] = baseDir + "tree-sitter-markdown/tree-sitter-markdown/queries/highlights.scm";
-        queryFiles[FileType::JSON] = baseDir + "tree-sitter-json/queries/highlights.scm";
-        queryFiles[FileType::XML] = baseDir + "tree-sitter-xml/queries/highlights.scm";
-        queryFiles[FileType::YAML] = baseDir + "tree-sitter-yaml/queries/highlights.scm";
+    const TSLanguage* language = QueryRegistry::language(fileType);
+    if (!language)
+    {
+        return false;
     }
     
-    // Check if we have a cached query for this file type
-    if (cachedQueries.contains(fileType)) {
-        return cachedQueries[fileType].constData();
+    if (fileType != m_treeFileType)
+    {
+        ts_parser_set_language(m_parser, language);
+        m_treeFileType = fileType;
     }
     
-    // Try to load the query file
-    QString filePath = queryFiles.value(fileType, "");
-    if (!filePath.isEmpty()) {
-        QFile file(filePath);
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QByteArray content = file.readAll();
-            file.close();
-            
-            // Append additional queries for specific languages to augment the official .scm
-            if (fileType == FileType::CPP || fileType == FileType::C) {
-                // Add essential missing patterns from C/C++ that aren't in the .scm
-                content.append("\n; Additional essential patterns\n");
-                content.append("(string_literal) @string\n");
-                content.append("(system_lib_string) @string\n");
-                content.append("(char_literal) @string\n");
-                content.append("(number_literal) @number\n");
-                content.append("(comment) @comment\n");
-                content.append("(true) @constant\n");
-                content.append("(false) @constant\n");
-                content.append("(type_identifier) @type\n");
-                content.append("(primitive_type) @type\n");
-                content.append("(sized_type_specifier) @type\n");
-                content.append("(call_expression function: (identifier) @function)\n");
-            }
-            
-            cachedQueries[fileType] = content;
-            qDebug() << "Loaded query file:" << filePath << "Size:" << content.size();
-            return cachedQueries[fileType].constData();
-        } else {
-            qDebug() << "Failed to open query file:" << filePath;
-        }
-    } else {
-        qDebug() << "No query file mapped for file type:" << static_cast<int>(fileType);
+    appendChunks(m_chunks, text, ChunkChars);
+    for (int i = 0; i < m_chunks.size(); ++i)
+    {
+        m_chunkStarts.append(i * ChunkChars);
     }
+    m_sourceSize = text.size();
+    m_hasSource = true;
     
-    // Fallback to empty query if file not found
-    return "";
+    m_lineStarts.clear();
+    m_lineStarts.append(0);
+    for (int i = text.indexOf(QLatin1Char('\n')); i >= 0; i = text.indexOf(QLatin1Char('\n'), i + 1))
+    {
+        m_lineStarts.append(i + 1);
+    }
+    return true;
 }
 
-QVector<HighlightInfo> TreeSitterWrapper::parseAndHighlight(const QString& text, FileType fileType)
+QVector<HighlightInfo> TreeSitterWrapper::reparseAndHighlight()
 {
     QVector<HighlightInfo> highlights;
     
-    if (!isLanguageSupported(fileType))
+    if (!m_hasSource)
     {
         return highlights;
     }
     
-    const TSLanguage* language = getLanguage(fileType);
-    if (!language)
+    // Parse the source, reusing the edited old tree when there is one
+    TSInput input = {};
+    input.payload = this;
+    input.read = &TreeSitterWrapper::readSource;
+    input.encoding = Utf16Encoding;
+    TSTree* tree = ts_parser_parse(m_parser, m_tree, input);
+    
+    if (!tree)
     {
+        reset();
         return highlights;
     }
     
-    // Set the language for the parser
-    ts_parser_set_language(m_parser, language);
-    
-    // Parse the text
-    QByteArray utf8Text = text.toUtf8();
-    TSTree* tree = ts_parser_parse_string(m_parser, nullptr, utf8Text.constData(), utf8Text.length());
+    m_changedRows.clear();
+    if (m_tree)
+    {
+        // Compare against the edited old tree to find where highlighting may differ
+        uint32_t rangeCount = 0;
+        TSRange* ranges = ts_tree_get_changed_ranges(m_tree, tree, &rangeCount);
+        for (uint32_t i = 0; i < rangeCount; i++)
+        {
+            m_changedRows.append(RowRange{static_cast<int>(ranges[i].start_point.row),
+                                          static_cast<int>(ranges[i].end_point.row)});
+        }
+        free(ranges);
+        
+        ts_tree_delete(m_tree);
+    }
+    m_tree = tree;
     
-    if (!tree)
+    return highlight();
+}
+
+QVector<HighlightInfo> TreeSitterWrapper::highlight()
+{
+    if (!m_tree)
     {
-        return highlights;
+        return QVector<HighlightInfo>();
     }
     
     // Extract highlights using queries
-    highlights = extractHighlights(text, tree, fileType);
-    
-    // Clean up
-    ts_tree_delete(tree);
-    
-    return highlights;
+    return extractHighlights(m_tree, m_treeFileType);
 }
 
-QVector<HighlightInfo> TreeSitterWrapper::extractHighlights(const QString& text, TSTree* tree, FileType fileType)
+void TreeSitterWrapper::setQueryRows(int firstRow, int lastRow)
 {
-    QVector<HighlightInfo> highlights;
+    m_queryFirstRow = firstRow;
+    m_queryLastRow = lastRow;
+}
+
+bool TreeSitterWrapper::applyEdit(int position, int charsRemoved, const QString& insertedText)
+{
+    const int oldEnd = position + charsRemoved;
+    if (!m_hasSource || position < 0 || charsRemoved < 0 || oldEnd > m_sourceSize)
+    {
+        reset();
+        return false;
+    }
+    
+    const int startRow = rowAt(position);
+    const int oldEndRow = rowAt(oldEnd);
+    const TSPoint startPoint = pointAt(startRow, position);
+    const TSPoint oldEndPoint = pointAt(oldEndRow, oldEnd);
     
-    const char* querySource = getQueryPatterns(fileType);
-    if (!querySource || querySource[0] == '\0')
+    // Keep the source and line index in step so later edits map correctly
+    replaceSource(position, charsRemoved, insertedText);
+    
+    const int delta = insertedText.size() - charsRemoved;
+    QVector<int> insertedStarts;
+    for (int i = insertedText.indexOf(QLatin1Char('\n')); i >= 0; i = insertedText.indexOf(QLatin1Char('\n'), i + 1))
     {
-        return highlights;
+        insertedStarts.append(position + i + 1);
     }
+    m_lineStarts.remove(startRow + 1, oldEndRow - startRow);
+    for (int row = startRow + 1; row < m_lineStarts.size(); ++row)
+    {
+        m_lineStarts[row] += delta;
+    }
+    m_lineStarts.insert(startRow + 1, insertedStarts.size(), 0);
+    std::copy(insertedStarts.begin(), insertedStarts.end(), m_lineStarts.begin() + startRow + 1);
     
-    // Get or create query for this file type
-    TSQuery* query = m_queries.value(fileType, nullptr);
-    if (!query)
+    const int newEnd = position + insertedText.size();
+    const TSPoint newEndPoint = pointAt(startRow + insertedStarts.size(), newEnd);
+    
+    if (m_tree)
     {
-        uint32_t error_offset;
-        TSQueryError error_type;
-        const TSLanguage* language = getLanguage(fileType);
-        
-        query = ts_query_new(language, querySource, strlen(querySource), &error_offset, &error_type);
+        TSInputEdit edit;
+        edit.start_byte = position * BytesPerChar;
+        edit.old_end_byte = oldEnd * BytesPerChar;
+        edit.new_end_byte = newEnd * BytesPerChar;
+        edit.start_point = startPoint;
+        edit.old_end_point = oldEndPoint;
+        edit.new_end_point = newEndPoint;
+        ts_tree_edit(m_tree, &edit);
+    }
+    
+    return true;
+}
+
+int TreeSitterWrapper::chunkAt(int position) const
+{
+    auto it = std::upper_bound(m_chunkStarts.begin(), m_chunkStarts.end(), position);
+    return qMax(0, static_cast<int>(it - m_chunkStarts.begin()) - 1);
+}
+
+void TreeSitterWrapper::replaceSource(int position, int charsRemoved, const QString& insertedText)
+{
+    if (m_chunks.isEmpty())
+    {
+        appendChunks(m_chunks, insertedText, ChunkChars);
+    }
+    else
+    {
+        // Splice the chunks the edit touches into one piece, taking the next
+        // chunk along when that piece gets small so chunks don't fragment
+        const int first = chunkAt(position);
+        int last = chunkAt(position + charsRemoved);
+        QString text = m_chunks[first].left(position - m_chunkStarts[first]) + insertedText
+                       + m_chunks[last].mid(position + charsRemoved - m_chunkStarts[last]);
+        if (text.size() < ChunkChars / 4 && last + 1 < m_chunks.size())
+        {
+            ++last;
+            text += m_chunks[last];
+        }
         
-        if (!query || error_type != TSQueryErrorNone)
+        QVector<QString> pieces;
+        if (text.size() <= 2 * ChunkChars)
         {
-            if (query)
+            if (!text.isEmpty())
             {
-                ts_query_delete(query);
+                pieces.append(text);
             }
-            return highlights;
         }
-        
-        m_queries[fileType] = query;
+        else
+        {
+            appendChunks(pieces, text, ChunkChars);
+        }
+        m_chunks.remove(first, last - first + 1);
+        m_chunks.insert(first, pieces.size(), QString());
+        std::copy(pieces.begin(), pieces.end(), m_chunks.begin() + first);
+    }
+    m_sourceSize += insertedText.size() - charsRemoved;
+    
+    m_chunkStarts.resize(m_chunks.size());
+    int start = 0;
+    for (int i = 0; i < m_chunks.size(); ++i)
+    {
+        m_chunkStarts[i] = start;
+        start += m_chunks[i].size();
+    }
+}
+
+const char* TreeSitterWrapper::readSource(void* payload, uint32_t byteIndex, TSPoint position, uint32_t* bytesRead)
+{
+    Q_UNUSED(position);
+    const TreeSitterWrapper* wrapper = static_cast<const TreeSitterWrapper*>(payload);
+    const int offset = static_cast<int>(byteIndex / BytesPerChar);
+    if (offset >= wrapper->m_sourceSize)
+    {
+        *bytesRead = 0;
+        return "";
     }
     
+    const int chunk = wrapper->chunkAt(offset);
+    const QString& text = wrapper->m_chunks[chunk];
+    const int chunkOffset = offset - wrapper->m_chunkStarts[chunk];
+    *bytesRead = static_cast<uint32_t>((text.size() - chunkOffset) * BytesPerChar);
+    return reinterpret_cast<const char*>(text.utf16() + chunkOffset);
+}
+
+int TreeSitterWrapper::rowAt(int position) const
+{
+    auto it = std::upper_bound(m_lineStarts.begin(), m_lineStarts.end(), position);
+    return static_cast<int>(it - m_lineStarts.begin()) - 1;
+}
+
+TSPoint TreeSitterWrapper::pointAt(int row, int position) const
+{
+    TSPoint point;
+    point.row = row;
+    point.column = (position - m_lineStarts[row]) * BytesPerChar;
+    return point;
+}
+
+void TreeSitterWrapper::reset()
+{
+    if (m_tree)
+    {
+        ts_tree_delete(m_tree);
+        m_tree = nullptr;
+    }
+    m_chunks.clear();
+    m_chunkStarts.clear();
+    m_sourceSize = 0;
+    m_lineStarts.clear();
+    m_hasSource = false;
+    m_changedRows.clear();
+}
+
+QVector<HighlightInfo> TreeSitterWrapper::extractHighlights(TSTree* tree, FileType fileType)
+{
+    QVector<HighlightInfo> highlights;
+    
+    // The compiled query is shared by every wrapper; only the cursor is ours
+    const CompiledQuery* compiled = QueryRegistry::instance().highlightQuery(fileType);
+    if (!compiled)
+    {
+        return highlights;
+    }
+    
+    TSQuery* query = compiled->query;
+    const QVector<HighlightType>& captureTypes = compiled->captureTypes;
+    
     // Create query cursor
     TSQueryCursor* cursor = ts_query_cursor_new();
     TSNode rootNode = ts_tree_root_node(tree);
+    if (m_queryFirstRow >= 0 && m_queryLastRow >= m_queryFirstRow)
+    {
+        // Only materialize captures near the viewport; the rest of the file
+        // is queried when it scrolls into view
+        TSPoint startPoint = {static_cast<uint32_t>(m_queryFirstRow), 0};
+        TSPoint endPoint = {static_cast<uint32_t>(m_queryLastRow) + 1, 0};
+        ts_query_cursor_set_point_range(cursor, startPoint, endPoint);
+    }
     ts_query_cursor_exec(cursor, query, rootNode);
     
     // Extract matches
@@ -276,23 +344,23 @@ QVector<HighlightInfo> TreeSitterWrapper::extractHighlights(const QString& text,
         for (uint16_t i = 0; i < match.capture_count; i++)
         {
             TSQueryCapture capture = match.captures[i];
-            TSNode node = capture.node;
-            
-            uint32_t start_byte = ts_node_start_byte(node);
-            uint32_t end_byte = ts_node_end_byte(node);
-            
-            // Get capture name
-            uint32_t length;
-            const char* name = ts_query_capture_name_for_id(query, capture.index, &length);
-            QString captureName = QString::fromUtf8(name, length);
-            
-            HighlightType type = captureNameToHighlightType(captureName);
+            HighlightType type = captureTypes[capture.index];
             
             if (type != HighlightType::None)
             {
+                TSNode node = capture.node;
+                uint32_t start_byte = ts_node_start_byte(node);
+                uint32_t end_byte = ts_node_end_byte(node);
+                TSPoint start_point = ts_node_start_point(node);
+                TSPoint end_point = ts_node_end_point(node);
+                
                 HighlightInfo info;
-                info.start = start_byte;
-                info.length = end_byte - start_byte;
+                info.start = start_byte / BytesPerChar;
+                info.length = (end_byte - start_byte) / BytesPerChar;
+                info.startRow = start_point.row;
+                info.startColumn = start_point.column / BytesPerChar;
+                info.endRow = end_point.row;
+                info.endColumn = end_point.column / BytesPerChar;
                 info.type = type;
                 highlights.append(info);
             }
@@ -304,23 +372,3 @@ QVector<HighlightInfo> TreeSitterWrapper::extractHighlights(const QString& text,
     
     return highlights;
 }
-
-HighlightType TreeSitterWrapper::captureNameToHighlightType(const QString& captureName) const
-{
-    if (captureName == "keyword") return HighlightType::Keyword;
-    if (captureName == "comment") return HighlightType::Comment;
-    if (captureName == "string") return HighlightType::String;
-    if (captureName == "number") return HighlightType::Number;
-    if (captureName == "function") return HighlightType::Function;
-    if (captureName == "class") return HighlightType::Class;
-    if (captureName == "type") return HighlightType::Type;
-    if (captureName == "variable") return HighlightType::Variable;
-    if (captureName == "operator") return HighlightType::Operator;
-    if (captureName == "punctuation") return HighlightType::Punctuation;
-    if (captureName == "property") return HighlightType::Property;
-    if (captureName == "parameter") return HighlightType::Parameter;
-    if (captureName == "constant") return HighlightType::Constant;
-    
-    return HighlightType::None;
-}
-
@@ -10,6 +10,7 @@ EditMenu::EditMenu(MainWindow* parent, QMenuBar* menuBar, openide::code::CodeTab
     , m_mainWindow(parent)
     , m_codeTabPane(codeTabPane)
     , m_findAction(nullptr)
+    , m_findInFilesAction(nullptr)
 {
     if (!parent || !menuBar) return;
 
@@ -22,8 +23,14 @@ EditMenu::EditMenu(MainWindow* parent, QMenuBar* menuBar, openide::code::CodeTab
     // Initially disabled until a CodeEditor is active
     m_findAction->setEnabled(false);
     
+    // Find in files works without an open editor
+    m_findInFilesAction = new QAction("Find in F&iles", this);
+    m_findInFilesAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_F));
+    editMenu->addAction(m_findInFilesAction);
+    
     // Connect actions
     connect(m_findAction, &QAction::triggered, this, &EditMenu::onFindTriggered);
+    connect(m_findInFilesAction, &QAction::triggered, this, &EditMenu::onFindInFilesTriggered);
 }
 
 void EditMenu::updateFindActionState()
@@ -51,3 +58,10 @@ void EditMenu::onFindTriggered()
     }
 }
 
+void EditMenu::onFindInFilesTriggered()
+{
+    if (m_mainWindow) {
+        m_mainWindow->showSearchPanel();
+    }
+}
+
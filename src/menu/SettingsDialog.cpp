@@ -7,6 +7,7 @@
 #include <QDialogButtonBox>
 #include <QFontComboBox>
 #include <QSpinBox>
+#include <QCheckBox>
 #include <QPushButton>
 #include <QLabel>
 #include <QGroupBox>
@@ -20,10 +21,13 @@ SettingsDialog::SettingsDialog(MainWindow* parent, AppSettings* settings)
     , m_fontComboBox(nullptr)
     , m_fontSizeSpinBox(nullptr)
     , m_tabSpaceSpinBox(nullptr)
+    , m_largeFileThresholdSpinBox(nullptr)
     , m_projectTreeFontComboBox(nullptr)
     , m_projectTreeFontSizeSpinBox(nullptr)
     , m_terminalFontComboBox(nullptr)
     , m_terminalFontSizeSpinBox(nullptr)
+    , m_terminalScrollbackSpinBox(nullptr)
+    , m_searchIndexCheckBox(nullptr)
     , m_okButton(nullptr)
     , m_cancelButton(nullptr)
     , m_applyButton(nullptr)
@@ -64,6 +68,13 @@ void SettingsDialog::setupUI()
     m_tabSpaceSpinBox->setValue(4);
     codeEditorLayout->addRow("Tab Space:", m_tabSpaceSpinBox);
     
+    m_largeFileThresholdSpinBox = new QSpinBox(codeEditorGroup);
+    m_largeFileThresholdSpinBox->setMinimum(1);
+    m_largeFileThresholdSpinBox->setMaximum(65536);
+    m_largeFileThresholdSpinBox->setSuffix(" MB");
+    m_largeFileThresholdSpinBox->setValue(64);
+    codeEditorLayout->addRow("Large File Mode Above:", m_largeFileThresholdSpinBox);
+    
     codeEditorGroup->setLayout(codeEditorLayout);
     mainLayout->addWidget(codeEditorGroup);
     
@@ -96,9 +107,28 @@ void SettingsDialog::setupUI()
     m_terminalFontSizeSpinBox->setValue(10);
     terminalLayout->addRow("Font Size:", m_terminalFontSizeSpinBox);
     
+    m_terminalScrollbackSpinBox = new QSpinBox(terminalGroup);
+    m_terminalScrollbackSpinBox->setMinimum(1000);
+    m_terminalScrollbackSpinBox->setMaximum(1000000);
+    m_terminalScrollbackSpinBox->setSingleStep(1000);
+    m_terminalScrollbackSpinBox->setValue(10000);
+    m_terminalScrollbackSpinBox->setSuffix(" lines");
+    terminalLayout->addRow("Scrollback:", m_terminalScrollbackSpinBox);
+    
     terminalGroup->setLayout(terminalLayout);
     mainLayout->addWidget(terminalGroup);
     
+    // Search section
+    QGroupBox* searchGroup = new QGroupBox("Search", this);
+    QFormLayout* searchLayout = new QFormLayout(searchGroup);
+    
+    m_searchIndexCheckBox = new QCheckBox("Index projects for faster Find in Files", searchGroup);
+    m_searchIndexCheckBox->setChecked(true);
+    searchLayout->addRow(m_searchIndexCheckBox);
+    
+    searchGroup->setLayout(searchLayout);
+    mainLayout->addWidget(searchGroup);
+    
     mainLayout->addStretch();
     
     // Buttons
@@ -123,6 +153,7 @@ void SettingsDialog::loadSettings()
     m_fontComboBox->setCurrentFont(QFont(m_settings->fontFamily()));
     m_fontSizeSpinBox->setValue(m_settings->fontSize());
     m_tabSpaceSpinBox->setValue(m_settings->tabSpace());
+    m_largeFileThresholdSpinBox->setValue(m_settings->largeFileThresholdMB());
     
     // Project Tree settings
     m_projectTreeFontComboBox->setCurrentFont(QFont(m_settings->projectTreeFontFamily()));
@@ -131,6 +162,10 @@ void SettingsDialog::loadSettings()
     // Terminal settings
     m_terminalFontComboBox->setCurrentFont(QFont(m_settings->terminalFontFamily()));
     m_terminalFontSizeSpinBox->setValue(m_settings->terminalFontSize());
+    m_terminalScrollbackSpinBox->setValue(m_settings->terminalScrollbackLines());
+    
+    // Search settings
+    m_searchIndexCheckBox->setChecked(m_settings->searchIndexEnabled());
 }
 
 void SettingsDialog::applySettings()
@@ -141,6 +176,7 @@ void SettingsDialog::applySettings()
     m_settings->setFontFamily(m_fontComboBox->currentFont().family());
     m_settings->setFontSize(m_fontSizeSpinBox->value());
     m_settings->setTabSpace(m_tabSpaceSpinBox->value());
+    m_settings->setLargeFileThresholdMB(m_largeFileThresholdSpinBox->value());
     
     // Project Tree settings
     m_settings->setProjectTreeFontFamily(m_projectTreeFontComboBox->currentFont().family());
@@ -149,6 +185,10 @@ void SettingsDialog::applySettings()
     // Terminal settings
     m_settings->setTerminalFontFamily(m_terminalFontComboBox->currentFont().family());
     m_settings->setTerminalFontSize(m_terminalFontSizeSpinBox->value());
+    m_settings->setTerminalScrollbackLines(m_terminalScrollbackSpinBox->value());
+    
+    // Search settings
+    m_settings->setSearchIndexEnabled(m_searchIndexCheckBox->isChecked());
     
     m_settings->saveToFile();
     emit settingsChanged();
@@ -0,0 +1,150 @@
+#include "search/GitIgnore.hpp"
+#include <QFile>
+
+using namespace openide::search;
+
+std::shared_ptr<const GitIgnore> GitIgnore::load(const QString& path, const QString& baseDir)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return nullptr;
+    }
+    
+    auto ignore = std::make_shared<GitIgnore>();
+    ignore->m_baseDir = baseDir.isEmpty() ? QString() : baseDir + '/';
+    while (!file.atEnd())
+    {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+        
+        Rule rule{QRegularExpression(), false, false};
+        if (line.startsWith('!'))
+        {
+            rule.negated = true;
+            line.remove(0, 1);
+        }
+        else if (line.startsWith("\\#") || line.startsWith("\\!"))
+        {
+            line.remove(0, 1);
+        }
+        if (line.endsWith('/'))
+        {
+            rule.directoryOnly = true;
+            line.chop(1);
+        }
+        // A slash anywhere but the end ties the pattern to this directory
+        const bool anchored = line.contains('/');
+        if (line.startsWith('/'))
+        {
+            line.remove(0, 1);
+        }
+        if (line.isEmpty())
+        {
+            continue;
+        }
+        
+        rule.regex = QRegularExpression(patternToRegex(line, anchored));
+        if (rule.regex.isValid())
+        {
+            ignore->m_rules.append(rule);
+        }
+    }
+    
+    if (ignore->m_rules.isEmpty())
+    {
+        return nullptr;
+    }
+    return ignore;
+}
+
+GitIgnore::Match GitIgnore::match(const QString& relativePath, bool isDir) const
+{
+    if (!relativePath.startsWith(m_baseDir))
+    {
+        return Match::None;
+    }
+    const QString path = relativePath.mid(m_baseDir.size());
+    
+    for (auto rule = m_rules.crbegin(); rule != m_rules.crend(); ++rule)
+    {
+        if (rule->directoryOnly && !isDir)
+        {
+            continue;
+        }
+        if (rule->regex.match(path).hasMatch())
+        {
+            return rule->negated ? Match::Included : Match::Ignored;
+        }
+    }
+    return Match::None;
+}
+
+QString GitIgnore::patternToRegex(QStringView pattern, bool anchored)
+{
+    // Unanchored patterns match at any depth
+    QString regex = anchored ? QStringLiteral("^") : QStringLiteral("^(?:.*/)?");
+    const qsizetype length = pattern.size();
+    for (qsizetype i = 0; i < length; ++i)
+    {
+        const QChar c = pattern[i];
+        if (c == '*')
+        {
+            const bool doubleStar = i + 1 < length && pattern[i + 1] == '*';
+            const bool segmentStart = i == 0 || pattern[i - 1] == '/';
+            if (doubleStar && segmentStart && i + 2 < length && pattern[i + 2] == '/')
+            {
+                // "**/" matches zero or more directories
+                regex += QStringLiteral("(?:.*/)?");
+                i += 2;
+            }
+            else if (doubleStar && segmentStart && i + 2 == length)
+            {
+                // A trailing "/**" matches everything inside
+                regex += QStringLiteral(".*");
+                i += 1;
+            }
+            else
+            {
+                regex += QStringLiteral("[^/]*");
+                if (doubleStar)
+                {
+                    i += 1;
+                }
+            }
+        }
+        else if (c == '?')
+        {
+            regex += QStringLiteral("[^/]");
+        }
+        else if (c == '[')
+        {
+            const qsizetype close = pattern.indexOf(']', i + 2);
+            if (close < 0)
+            {
+                regex += QStringLiteral("\\[");
+                continue;
+            }
+            QString set = pattern.mid(i + 1, close - i - 1).toString();
+            if (set.startsWith('!'))
+            {
+                set[0] = '^';
+            }
+            set.replace('\\', QStringLiteral("\\\\"));
+            regex += QLatin1Char('[') + set + QLatin1Char(']');
+            i = close;
+        }
+        else if (c == '\\' && i + 1 < length)
+        {
+            regex += QRegularExpression::escape(pattern.mid(++i, 1).toString());
+        }
+        else
+        {
+            regex += QRegularExpression::escape(QString(c));
+        }
+    }
+    return regex + QLatin1Char('$');
+}
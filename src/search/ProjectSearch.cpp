@@ -0,0 +1,224 @@
+#include "search/ProjectSearch.hpp"
+#include "search/ProjectWalker.hpp"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QPointer>
+#include <QRunnable>
+#include <QThread>
+#include <atomic>
+#include <cstring>
+
+using namespace openide::search;
+
+// State shared by the tasks of one search. The owner pointer is only
+// checked on the GUI thread, where the ProjectSearch lives.
+struct ProjectSearch::Run
+{
+    Run(const QString& root, const QString& pattern, const SearchOptions& options)
+        : root(root)
+        , matcher(pattern, options)
+    {
+    }
+    
+    const QString root;
+    const TextMatcher matcher;
+    QPointer<ProjectSearch> owner;
+    QThreadPool* pool = nullptr;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> limitReached{false};
+    std::atomic<int> pendingTasks{0};
+    std::atomic<int> filesSearched{0};
+    std::atomic<int> matchCount{0};
+};
+
+ProjectSearch::ProjectSearch(QObject* parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<openide::search::FileMatches>();
+    
+    // Its own pool, so a search never delays highlighting or saving on the
+    // shared ones
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+ProjectSearch::~ProjectSearch()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+bool ProjectSearch::start(const QString& root, const QString& pattern, const SearchOptions& options)
+{
+    std::shared_ptr<Run> run = createRun(QDir(root).absolutePath(), pattern, options);
+    if (!run)
+    {
+        return false;
+    }
+    m_pool.start(QRunnable::create([run]() { walk(run); }));
+    return true;
+}
+
+bool ProjectSearch::startInFiles(FileSource files, const QString& pattern, const SearchOptions& options)
+{
+    std::shared_ptr<Run> run = createRun(QString(), pattern, options);
+    if (!run)
+    {
+        return false;
+    }
+    m_pool.start(QRunnable::create([run, files]() { walkFiles(run, files); }));
+    return true;
+}
+
+std::shared_ptr<ProjectSearch::Run> ProjectSearch::createRun(const QString& root, const QString& pattern,
+                                                             const SearchOptions& options)
+{
+    cancel();
+    
+    auto run = std::make_shared<Run>(root, pattern, options);
+    if (!run->matcher.isValid())
+    {
+        m_errorString = run->matcher.errorString();
+        return nullptr;
+    }
+    m_errorString.clear();
+    run->owner = this;
+    run->pool = &m_pool;
+    run->pendingTasks = 1;
+    m_run = run;
+    return run;
+}
+
+void ProjectSearch::cancel()
+{
+    // Tasks still running notice the flag and stop; their results are dropped
+    if (m_run)
+    {
+        m_run->cancelled = true;
+        m_run.reset();
+    }
+}
+
+void ProjectSearch::walk(std::shared_ptr<Run> run)
+{
+    QStringList batch;
+    ProjectWalker::walk(run->root, QString(), [&run, &batch](const QFileInfo& entry, const QString&) {
+        batch.append(entry.filePath());
+        if (batch.size() >= FilesPerTask)
+        {
+            dispatch(run, batch);
+        }
+    }, nullptr, run->cancelled);
+    
+    dispatch(run, batch);
+    taskDone(run);
+}
+
+void ProjectSearch::walkFiles(std::shared_ptr<Run> run, const FileSource& files)
+{
+    QStringList batch;
+    files([&run, &batch](const QString& path) {
+        batch.append(path);
+        if (batch.size() >= FilesPerTask)
+        {
+            dispatch(run, batch);
+        }
+    }, run->cancelled);
+    
+    dispatch(run, batch);
+    taskDone(run);
+}
+
+void ProjectSearch::dispatch(std::shared_ptr<Run> run, QStringList& paths)
+{
+    if (paths.isEmpty() || run->cancelled)
+    {
+        paths.clear();
+        return;
+    }
+    ++run->pendingTasks;
+    run->pool->start(QRunnable::create([run, paths]() { searchFiles(run, paths); }));
+    paths.clear();
+}
+
+void ProjectSearch::searchFiles(std::shared_ptr<Run> run, const QStringList& paths)
+{
+    for (const QString& path : paths)
+    {
+        if (run->cancelled)
+        {
+            break;
+        }
+        searchFile(run, path);
+    }
+    taskDone(run);
+}
+
+void ProjectSearch::searchFile(const std::shared_ptr<Run>& run, const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+    {
+        return;
+    }
+    
+    // Mapped so the scan reads straight from the page cache; files that
+    // can't be mapped (pipes, some network mounts) are read instead
+    QByteArray buffer;
+    qint64 length = file.size();
+    uchar* mapping = file.map(0, length);
+    const char* data = reinterpret_cast<const char*>(mapping);
+    if (!mapping)
+    {
+        buffer = file.readAll();
+        data = buffer.constData();
+        length = buffer.size();
+    }
+    
+    ++run->filesSearched;
+    if (!std::memchr(data, 0, qMin(length, BinaryCheckBytes)))
+    {
+        const int remaining = MaxMatches - run->matchCount;
+        FileMatches result{path, run->matcher.search(data, length, remaining)};
+        if (!result.matches.isEmpty())
+        {
+            if ((run->matchCount += result.matches.size()) >= MaxMatches)
+            {
+                run->limitReached = true;
+                run->cancelled = true;
+            }
+            
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [run, result]() {
+                if (run->owner && run->owner->m_run == run)
+                {
+                    emit run->owner->fileMatched(result);
+                }
+            }, Qt::QueuedConnection);
+        }
+    }
+    
+    if (mapping)
+    {
+        file.unmap(mapping);
+    }
+}
+
+void ProjectSearch::taskDone(const std::shared_ptr<Run>& run)
+{
+    if (--run->pendingTasks > 0)
+    {
+        return;
+    }
+    QMetaObject::invokeMethod(QCoreApplication::instance(), [run]() {
+        ProjectSearch* owner = run->owner;
+        // A newer search replaced this one, or the owner is gone
+        if (!owner || owner->m_run != run)
+        {
+            return;
+        }
+        owner->m_run.reset();
+        emit owner->finished(run->filesSearched, run->matchCount, run->limitReached);
+    }, Qt::QueuedConnection);
+}
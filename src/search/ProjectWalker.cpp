@@ -0,0 +1,93 @@
+#include "search/ProjectWalker.hpp"
+#include <QDir>
+
+using namespace openide::search;
+
+void ProjectWalker::walk(const QString& root, const QString& relativeDir, const Visitor& onFile,
+                         const Visitor& onDirectory, const std::atomic<bool>& cancelled)
+{
+    struct Directory
+    {
+        QString path;      // relative to the root, empty for the root
+        Ignores ignores;   // in effect for its entries, innermost last
+    };
+    
+    QVector<Directory> pending{Directory{relativeDir, ignoresAbove(root, relativeDir)}};
+    while (!pending.isEmpty() && !cancelled)
+    {
+        Directory directory = pending.takeLast();
+        const QString absolutePath = directory.path.isEmpty() ? root : root + '/' + directory.path;
+        if (auto ignore = GitIgnore::load(absolutePath + "/.gitignore", directory.path))
+        {
+            directory.ignores.append(ignore);
+        }
+        if (onDirectory)
+        {
+            onDirectory(QFileInfo(absolutePath), directory.path);
+        }
+        
+        // Symlinked directories are skipped, so links can't form a cycle
+        const QFileInfoList entries = QDir(absolutePath).entryInfoList(
+            QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden, QDir::NoSort);
+        for (const QFileInfo& entry : entries)
+        {
+            const QString relativePath = directory.path.isEmpty() ? entry.fileName()
+                                                                  : directory.path + '/' + entry.fileName();
+            const bool isDir = entry.isDir();
+            if ((isDir && (entry.isSymLink() || entry.fileName() == ".git"))
+                || isIgnored(directory.ignores, relativePath, isDir))
+            {
+                continue;
+            }
+            
+            if (isDir)
+            {
+                pending.append(Directory{relativePath, directory.ignores});
+            }
+            else
+            {
+                onFile(entry, relativePath);
+            }
+        }
+    }
+}
+
+ProjectWalker::Ignores ProjectWalker::ignoresAbove(const QString& root, const QString& relativeDir)
+{
+    Ignores ignores;
+    if (auto exclude = GitIgnore::load(root + "/.git/info/exclude", QString()))
+    {
+        ignores.append(exclude);
+    }
+    
+    // The root's .gitignore, then each parent's down to relativeDir
+    if (relativeDir.isEmpty())
+    {
+        return ignores;
+    }
+    QString path;
+    const QStringList parts = relativeDir.split('/');
+    for (int i = 0; i < parts.size(); ++i)
+    {
+        if (auto ignore = GitIgnore::load((path.isEmpty() ? root : root + '/' + path) + "/.gitignore", path))
+        {
+            ignores.append(ignore);
+        }
+        path = path.isEmpty() ? parts[i] : path + '/' + parts[i];
+    }
+    return ignores;
+}
+
+bool ProjectWalker::isIgnored(const Ignores& ignores, const QString& relativePath, bool isDir)
+{
+    // Deeper ignore files take precedence over the ones above them
+    for (auto ignore = ignores.crbegin(); ignore != ignores.crend(); ++ignore)
+    {
+        const GitIgnore::Match match = (*ignore)->match(relativePath, isDir);
+        if (match != GitIgnore::Match::None)
+        {
+            return match == GitIgnore::Match::Ignored;
+        }
+    }
+    return false;
+}
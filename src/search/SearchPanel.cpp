@@ -0,0 +1,183 @@
+#include "search/SearchPanel.hpp"
+#include <QDir>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+using namespace openide::search;
+
+namespace
+{
+// Item data roles
+const int PathRole = Qt::UserRole;
+const int LineRole = Qt::UserRole + 1;
+}
+
+SearchPanel::SearchPanel(QWidget* parent)
+    : QWidget(parent)
+    , m_isIndexEnabled(false)
+    , m_usedIndex(false)
+    , m_matchCount(0)
+    , m_patternLineEdit(nullptr)
+    , m_regexCheckBox(nullptr)
+    , m_caseSensitiveCheckBox(nullptr)
+    , m_wholeWordsCheckBox(nullptr)
+    , m_searchButton(nullptr)
+    , m_statusLabel(nullptr)
+    , m_resultsTree(nullptr)
+{
+    setupUI();
+    
+    connect(&m_search, &ProjectSearch::fileMatched, this, &SearchPanel::onFileMatched);
+    connect(&m_search, &ProjectSearch::finished, this, &SearchPanel::onFinished);
+}
+
+void SearchPanel::setupUI()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(4, 4, 4, 4);
+    
+    // Pattern and options
+    QHBoxLayout* queryLayout = new QHBoxLayout();
+    m_patternLineEdit = new QLineEdit(this);
+    m_patternLineEdit->setPlaceholderText("Find in files");
+    m_regexCheckBox = new QCheckBox("Regex", this);
+    m_caseSensitiveCheckBox = new QCheckBox("Case Sensitive", this);
+    m_wholeWordsCheckBox = new QCheckBox("Whole Words", this);
+    m_searchButton = new QPushButton("Search", this);
+    queryLayout->addWidget(m_patternLineEdit, 1);
+    queryLayout->addWidget(m_regexCheckBox);
+    queryLayout->addWidget(m_caseSensitiveCheckBox);
+    queryLayout->addWidget(m_wholeWordsCheckBox);
+    queryLayout->addWidget(m_searchButton);
+    mainLayout->addLayout(queryLayout);
+    
+    // Results, one top-level item per file
+    m_resultsTree = new QTreeWidget(this);
+    m_resultsTree->setHeaderHidden(true);
+    m_resultsTree->setUniformRowHeights(true);
+    m_resultsTree->setColumnCount(1);
+    m_resultsTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    mainLayout->addWidget(m_resultsTree, 1);
+    
+    m_statusLabel = new QLabel(this);
+    mainLayout->addWidget(m_statusLabel);
+    
+    connect(m_searchButton, &QPushButton::clicked, this, &SearchPanel::onSearchClicked);
+    connect(m_patternLineEdit, &QLineEdit::returnPressed, this, &SearchPanel::onSearchClicked);
+    connect(m_resultsTree, &QTreeWidget::itemActivated, this, &SearchPanel::onItemActivated);
+}
+
+void SearchPanel::setRootPath(const QString& rootPath)
+{
+    m_search.cancel();
+    setSearching(false);
+    m_rootPath = rootPath;
+    m_resultsTree->clear();
+    m_statusLabel->clear();
+    m_index.open(m_isIndexEnabled ? m_rootPath : QString());
+}
+
+void SearchPanel::setIndexEnabled(bool isEnabled)
+{
+    if (m_isIndexEnabled == isEnabled) return;
+    
+    m_isIndexEnabled = isEnabled;
+    m_index.open(m_isIndexEnabled ? m_rootPath : QString());
+}
+
+void SearchPanel::activate()
+{
+    show();
+    m_patternLineEdit->setFocus();
+    m_patternLineEdit->selectAll();
+}
+
+void SearchPanel::onSearchClicked()
+{
+    // The button doubles as Stop while a search runs
+    if (m_search.isRunning()) {
+        m_search.cancel();
+        setSearching(false);
+        m_statusLabel->setText(QString("Stopped, %1 matches").arg(m_matchCount));
+        return;
+    }
+    
+    if (m_rootPath.isEmpty()) {
+        m_statusLabel->setText("Open a project to search it");
+        return;
+    }
+    
+    SearchOptions options;
+    options.regex = m_regexCheckBox->isChecked();
+    options.caseSensitive = m_caseSensitiveCheckBox->isChecked();
+    options.wholeWords = m_wholeWordsCheckBox->isChecked();
+    
+    m_resultsTree->clear();
+    m_matchCount = 0;
+    
+    // Scan only the files the index can't rule out; without a usable index
+    // (still building, or nothing to narrow by) walk the whole tree
+    const QString pattern = m_patternLineEdit->text();
+    ProjectSearch::FileSource candidates = m_index.candidates(pattern, options);
+    m_usedIndex = candidates != nullptr;
+    const bool started = m_usedIndex ? m_search.startInFiles(candidates, pattern, options)
+                                     : m_search.start(m_rootPath, pattern, options);
+    if (!started) {
+        m_statusLabel->setText(m_search.errorString());
+        return;
+    }
+    m_searchTimer.start();
+    setSearching(true);
+    m_statusLabel->setText("Searching...");
+}
+
+void SearchPanel::onFileMatched(const FileMatches& matches)
+{
+    QTreeWidgetItem* fileItem = new QTreeWidgetItem(m_resultsTree);
+    fileItem->setText(0, QString("%1 (%2)").arg(QDir(m_rootPath).relativeFilePath(matches.path))
+                                           .arg(matches.matches.size()));
+    fileItem->setData(0, PathRole, matches.path);
+    fileItem->setData(0, LineRole, -1);
+    
+    for (const SearchMatch& match : matches.matches) {
+        QTreeWidgetItem* matchItem = new QTreeWidgetItem(fileItem);
+        matchItem->setText(0, QString("%1: %2").arg(match.line + 1).arg(match.preview.trimmed()));
+        matchItem->setData(0, PathRole, matches.path);
+        matchItem->setData(0, LineRole, match.line);
+    }
+    fileItem->setExpanded(true);
+    
+    m_matchCount += matches.matches.size();
+    m_statusLabel->setText(QString("Searching... %1 matches").arg(m_matchCount));
+}
+
+void SearchPanel::onFinished(int filesSearched, int matchCount, bool limitReached)
+{
+    setSearching(false);
+    QString status = QString("%1 matches in %2 files, %3 files searched in %4 ms")
+                         .arg(matchCount)
+                         .arg(m_resultsTree->topLevelItemCount())
+                         .arg(filesSearched)
+                         .arg(m_searchTimer.elapsed());
+    if (m_usedIndex) {
+        status += " using the index";
+    }
+    if (limitReached) {
+        status += " (stopped at the result limit)";
+    }
+    m_statusLabel->setText(status);
+}
+
+void SearchPanel::onItemActivated(QTreeWidgetItem* item, int column)
+{
+    Q_UNUSED(column);
+    if (!item) return;
+    
+    emit matchActivated(item->data(0, PathRole).toString(), item->data(0, LineRole).toInt());
+}
+
+void SearchPanel::setSearching(bool isSearching)
+{
+    m_searchButton->setText(isSearching ? "Stop" : "Search");
+}
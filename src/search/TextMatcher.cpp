@@ -0,0 +1,294 @@
+#include "search/TextMatcher.hpp"
+#include <cstring>
+
+using namespace openide::search;
+
+namespace
+{
+char asciiLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+char asciiUpper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? char(c - 'a' + 'A') : c;
+}
+
+bool isAsciiLetter(char c)
+{
+    return asciiLower(c) != asciiUpper(c);
+}
+
+// Step back to the start of a UTF-8 sequence
+qint64 alignToChar(const char* data, qint64 pos, qint64 lowerBound)
+{
+    while (pos > lowerBound && (static_cast<uchar>(data[pos]) & 0xC0) == 0x80)
+    {
+        --pos;
+    }
+    return pos;
+}
+}
+
+TextMatcher::TextMatcher(const QString& pattern, const SearchOptions& options)
+    : m_isValid(false)
+    , m_useRegex(options.regex)
+    , m_caseSensitive(options.caseSensitive)
+    , m_wholeWords(options.wholeWords)
+    , m_anchorIndex(0)
+    , m_anchor(0)
+    , m_anchorAlt(0)
+{
+    if (pattern.isEmpty())
+    {
+        m_errorString = "Nothing to search for";
+        return;
+    }
+    
+    // Folding non-ASCII letters needs Unicode case tables
+    if (!m_useRegex && !m_caseSensitive)
+    {
+        for (QChar c : pattern)
+        {
+            if (c.unicode() >= 0x80 && c.toLower() != c.toUpper())
+            {
+                m_useRegex = true;
+                break;
+            }
+        }
+    }
+    
+    if (m_useRegex)
+    {
+        QString source = options.regex ? pattern : QRegularExpression::escape(pattern);
+        if (m_wholeWords)
+        {
+            source = "\\b(?:" + source + ")\\b";
+        }
+        QRegularExpression::PatternOptions patternOptions = QRegularExpression::MultilineOption;
+        if (!m_caseSensitive)
+        {
+            patternOptions |= QRegularExpression::CaseInsensitiveOption;
+        }
+        m_regex = QRegularExpression(source, patternOptions);
+        if (!m_regex.isValid())
+        {
+            m_errorString = m_regex.errorString();
+            return;
+        }
+        m_regex.optimize();
+        m_isValid = true;
+        return;
+    }
+    
+    m_needle = pattern.toUtf8();
+    if (!m_caseSensitive)
+    {
+        for (char& c : m_needle)
+        {
+            c = asciiLower(c);
+        }
+        // Scan for a byte that has only one case if there is one, so a
+        // single memchr finds every candidate
+        for (int i = 0; i < m_needle.size(); ++i)
+        {
+            if (!isAsciiLetter(m_needle[i]))
+            {
+                m_anchorIndex = i;
+                break;
+            }
+        }
+    }
+    m_anchor = m_needle[m_anchorIndex];
+    m_anchorAlt = m_caseSensitive ? m_anchor : asciiUpper(m_anchor);
+    m_isValid = true;
+}
+
+QVector<SearchMatch> TextMatcher::search(const char* data, qint64 size, int maxMatches) const
+{
+    if (!m_isValid || size <= 0 || maxMatches <= 0)
+    {
+        return QVector<SearchMatch>();
+    }
+    return m_useRegex ? searchRegex(data, size, maxMatches) : searchLiteral(data, size, maxMatches);
+}
+
+QVector<SearchMatch> TextMatcher::searchLiteral(const char* data, qint64 size, int maxMatches) const
+{
+    QVector<SearchMatch> matches;
+    const qint64 needleSize = m_needle.size();
+    if (needleSize > size)
+    {
+        return matches;
+    }
+    
+    const char* end = data + size;
+    // The anchor can't occur before this without the match starting before data
+    const char* scan = data + m_anchorIndex;
+    const char* scanEnd = end - (needleSize - m_anchorIndex - 1);
+    
+    // With two anchor cases, keep the next hit of each so neither is rescanned
+    const char* nextAnchor = nullptr;
+    const char* nextAlt = nullptr;
+    
+    // Lines are counted incrementally up to each match
+    int line = 0;
+    const char* lineStart = data;
+    const char* counted = data;
+    
+    while (scan < scanEnd)
+    {
+        const char* hit;
+        if (m_anchor == m_anchorAlt)
+        {
+            hit = static_cast<const char*>(std::memchr(scan, m_anchor, scanEnd - scan));
+        }
+        else
+        {
+            if (nextAnchor != scanEnd && (!nextAnchor || nextAnchor < scan))
+            {
+                nextAnchor = static_cast<const char*>(std::memchr(scan, m_anchor, scanEnd - scan));
+                nextAnchor = nextAnchor ? nextAnchor : scanEnd;
+            }
+            if (nextAlt != scanEnd && (!nextAlt || nextAlt < scan))
+            {
+                nextAlt = static_cast<const char*>(std::memchr(scan, m_anchorAlt, scanEnd - scan));
+                nextAlt = nextAlt ? nextAlt : scanEnd;
+            }
+            hit = qMin(nextAnchor, nextAlt);
+            hit = hit == scanEnd ? nullptr : hit;
+        }
+        if (!hit)
+        {
+            break;
+        }
+        
+        const char* candidate = hit - m_anchorIndex;
+        if (!matchesAt(candidate)
+            || (m_wholeWords && ((candidate > data && isWordByte(candidate[-1]))
+                                 || (candidate + needleSize < end && isWordByte(candidate[needleSize])))))
+        {
+            scan = hit + 1;
+            continue;
+        }
+        
+        while (const char* newline = static_cast<const char*>(std::memchr(counted, '\n', candidate - counted)))
+        {
+            ++line;
+            lineStart = newline + 1;
+            counted = lineStart;
+        }
+        counted = candidate;
+        
+        matches.append(locate(data, size, line, lineStart - data, candidate - data, needleSize));
+        if (matches.size() >= maxMatches)
+        {
+            break;
+        }
+        scan = hit + needleSize;
+    }
+    return matches;
+}
+
+QVector<SearchMatch> TextMatcher::searchRegex(const char* data, qint64 size, int maxMatches) const
+{
+    QVector<SearchMatch> matches;
+    const QString text = QString::fromUtf8(data, size);
+    
+    int line = 0;
+    qsizetype lineStart = 0;
+    QRegularExpressionMatchIterator it = m_regex.globalMatch(text);
+    while (it.hasNext() && matches.size() < maxMatches)
+    {
+        const QRegularExpressionMatch match = it.next();
+        if (match.capturedLength() == 0)
+        {
+            continue;
+        }
+        
+        const qsizetype start = match.capturedStart();
+        for (qsizetype newline = text.indexOf('\n', lineStart); newline >= 0 && newline < start;
+             newline = text.indexOf('\n', lineStart))
+        {
+            ++line;
+            lineStart = newline + 1;
+        }
+        
+        qsizetype lineEnd = text.indexOf('\n', start);
+        lineEnd = lineEnd < 0 ? text.size() : lineEnd;
+        if (lineEnd > lineStart && text[lineEnd - 1] == '\r')
+        {
+            --lineEnd;
+        }
+        
+        // Matches spanning lines are shown on their first line
+        qsizetype previewStart = lineStart;
+        qsizetype previewEnd = lineEnd;
+        if (previewEnd - previewStart > MaxPreviewBytes)
+        {
+            previewStart = qMax<qsizetype>(lineStart, start - PreviewContextBytes);
+            previewEnd = qMin<qsizetype>(lineEnd, previewStart + MaxPreviewBytes);
+        }
+        SearchMatch result;
+        result.line = line;
+        result.column = int(start - previewStart);
+        result.length = int(qMax<qsizetype>(0, qMin(start + match.capturedLength(), previewEnd) - start));
+        result.preview = text.mid(previewStart, previewEnd - previewStart);
+        matches.append(result);
+    }
+    return matches;
+}
+
+bool TextMatcher::matchesAt(const char* candidate) const
+{
+    if (m_caseSensitive)
+    {
+        return std::memcmp(candidate, m_needle.constData(), m_needle.size()) == 0;
+    }
+    for (int i = 0; i < m_needle.size(); ++i)
+    {
+        if (asciiLower(candidate[i]) != m_needle[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TextMatcher::isWordByte(char c)
+{
+    // Bytes of multi-byte characters count as word characters
+    const uchar u = static_cast<uchar>(c);
+    return u >= 0x80 || u == '_' || (u >= '0' && u <= '9') || isAsciiLetter(c);
+}
+
+SearchMatch TextMatcher::locate(const char* data, qint64 size, int line, qint64 lineStart,
+                                qint64 start, qint64 length)
+{
+    const char* newline = static_cast<const char*>(std::memchr(data + start, '\n', size - start));
+    qint64 lineEnd = newline ? newline - data : size;
+    if (lineEnd > lineStart && data[lineEnd - 1] == '\r')
+    {
+        --lineEnd;
+    }
+    
+    qint64 previewStart = lineStart;
+    qint64 previewEnd = lineEnd;
+    if (previewEnd - previewStart > MaxPreviewBytes)
+    {
+        previewStart = alignToChar(data, qMax(lineStart, start - PreviewContextBytes), lineStart);
+        previewEnd = qMin(lineEnd, previewStart + MaxPreviewBytes);
+        if (previewEnd < lineEnd)
+        {
+            previewEnd = alignToChar(data, previewEnd, start);
+        }
+    }
+    
+    SearchMatch match;
+    match.line = line;
+    match.column = int(QString::fromUtf8(data + previewStart, start - previewStart).size());
+    match.length = int(QString::fromUtf8(data + start, qMin(start + length, previewEnd) - start).size());
+    match.preview = QString::fromUtf8(data + previewStart, previewEnd - previewStart);
+    return match;
+}
@@ -0,0 +1,1059 @@
+#include "search/TrigramIndex.hpp"
+#include "search/ProjectWalker.hpp"
+#include "AppSettings.hpp"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMetaObject>
+#include <QPointer>
+#include <QRunnable>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+using namespace openide;
+using namespace openide::search;
+
+namespace
+{
+// Bumped whenever the file layout changes
+const quint32 IndexMagic = 0x6f695458; // "oiTX"
+const quint32 IndexVersion = 1;
+
+// Files larger than this aren't indexed and are always searched
+const qint64 MaxIndexedFileSize = 64 * 1024 * 1024;
+// Bytes checked for NULs to tell binary files apart, as ProjectSearch does
+const qint64 BinaryCheckBytes = 8 * 1024;
+
+// File layout: Header, FileEntry[fileCount], TrigramEntry[trigramCount]
+// sorted by trigram, quint32 postings[postingCount] (file ids, ascending per
+// trigram), then the UTF-8 paths. Every section stays 8-byte aligned.
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    quint32 fileCount;
+    quint32 trigramCount;
+    quint64 filesOffset;
+    quint64 trigramsOffset;
+    quint64 postingsOffset;
+    quint64 postingCount;
+    quint64 stringsOffset;
+    quint64 stringsSize;
+};
+
+enum FileFlags : quint32
+{
+    BinaryFile = 1,      // never matches
+    UnindexedFile = 2    // too large or unreadable, always a candidate
+};
+
+struct FileEntry
+{
+    quint64 pathOffset;  // into the strings section
+    quint32 pathLength;
+    quint32 flags;
+    qint64 modified;     // ms since the epoch
+    qint64 size;
+};
+
+struct TrigramEntry
+{
+    quint32 trigram;
+    quint32 count;
+    quint64 first;       // index of its first posting
+};
+
+char fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+// A saved index, mapped read-only and validated once so lookups can trust it
+class IndexFile
+{
+public:
+    static std::shared_ptr<const IndexFile> map(const QString& path)
+    {
+        auto index = std::shared_ptr<IndexFile>(new IndexFile(path));
+        if (!index->m_file.open(QIODevice::ReadOnly))
+        {
+            return nullptr;
+        }
+        const quint64 size = index->m_file.size();
+        if (size < sizeof(Header))
+        {
+            return nullptr;
+        }
+        index->m_data = index->m_file.map(0, size);
+        if (!index->m_data)
+        {
+            return nullptr;
+        }
+        
+        const Header* header = reinterpret_cast<const Header*>(index->m_data);
+        if (header->magic != IndexMagic || header->version != IndexVersion
+            || header->filesOffset + quint64(header->fileCount) * sizeof(FileEntry) > size
+            || header->trigramsOffset + quint64(header->trigramCount) * sizeof(TrigramEntry) > size
+            || header->postingsOffset + header->postingCount * sizeof(quint32) > size
+            || header->stringsOffset + header->stringsSize > size
+            || header->filesOffset % 8 || header->trigramsOffset % 8 || header->postingsOffset % 4)
+        {
+            return nullptr;
+        }
+        index->m_header = header;
+        index->m_files = reinterpret_cast<const FileEntry*>(index->m_data + header->filesOffset);
+        index->m_trigrams = reinterpret_cast<const TrigramEntry*>(index->m_data + header->trigramsOffset);
+        index->m_postings = reinterpret_cast<const quint32*>(index->m_data + header->postingsOffset);
+        index->m_strings = reinterpret_cast<const char*>(index->m_data + header->stringsOffset);
+        
+        for (quint32 id = 0; id < header->fileCount; ++id)
+        {
+            const FileEntry& file = index->m_files[id];
+            if (file.pathOffset + file.pathLength > header->stringsSize)
+            {
+                return nullptr;
+            }
+        }
+        for (quint32 i = 0; i < header->trigramCount; ++i)
+        {
+            const TrigramEntry& entry = index->m_trigrams[i];
+            if (entry.first + entry.count > header->postingCount
+                || (i > 0 && index->m_trigrams[i - 1].trigram >= entry.trigram))
+            {
+                return nullptr;
+            }
+        }
+        return index;
+    }
+    
+    ~IndexFile()
+    {
+        if (m_data)
+        {
+            m_file.unmap(m_data);
+        }
+    }
+    
+    quint32 fileCount() const { return m_header->fileCount; }
+    const FileEntry& file(quint32 id) const { return m_files[id]; }
+    QString path(quint32 id) const
+    {
+        return QString::fromUtf8(m_strings + m_files[id].pathOffset, m_files[id].pathLength);
+    }
+    
+    const TrigramEntry* trigramsBegin() const { return m_trigrams; }
+    const TrigramEntry* trigramsEnd() const { return m_trigrams + m_header->trigramCount; }
+    const quint32* postings(const TrigramEntry& entry) const { return m_postings + entry.first; }
+    
+    // Files containing trigram, as a range of ascending ids
+    std::pair<const quint32*, const quint32*> find(quint32 trigram) const
+    {
+        const TrigramEntry* entry = std::lower_bound(trigramsBegin(), trigramsEnd(), trigram,
+            [](const TrigramEntry& e, quint32 t) { return e.trigram < t; });
+        if (entry == trigramsEnd() || entry->trigram != trigram)
+        {
+            return {nullptr, nullptr};
+        }
+        return {postings(*entry), postings(*entry) + entry->count};
+    }
+    
+private:
+    explicit IndexFile(const QString& path)
+        : m_file(path)
+    {
+    }
+    
+    QFile m_file;
+    uchar* m_data = nullptr;
+    const Header* m_header = nullptr;
+    const FileEntry* m_files = nullptr;
+    const TrigramEntry* m_trigrams = nullptr;
+    const quint32* m_postings = nullptr;
+    const char* m_strings = nullptr;
+};
+
+// Distinct trigrams of one file. A bit per possible trigram (2 MiB) makes
+// adding one a single test, and is reused from file to file.
+class TrigramSet
+{
+public:
+    TrigramSet()
+        : m_bits(1 << 18, 0)
+    {
+    }
+    
+    void add(const char* data, qint64 size)
+    {
+        quint32 trigram = 0;
+        for (qint64 i = 0; i < size; ++i)
+        {
+            trigram = ((trigram << 8) | uchar(fold(data[i]))) & 0xFFFFFF;
+            if (i < 2)
+            {
+                continue;
+            }
+            quint64& word = m_bits[trigram >> 6];
+            const quint64 bit = quint64(1) << (trigram & 63);
+            if (!(word & bit))
+            {
+                word |= bit;
+                m_members.append(trigram);
+            }
+        }
+    }
+    
+    // The trigrams added since the last call, sorted
+    QVector<quint32> take()
+    {
+        for (quint32 trigram : m_members)
+        {
+            m_bits[trigram >> 6] = 0;
+        }
+        QVector<quint32> members;
+        members.swap(m_members);
+        std::sort(members.begin(), members.end());
+        return members;
+    }
+    
+private:
+    QVector<quint64> m_bits;
+    QVector<quint32> m_members;
+};
+}
+
+// What the index knows: a mapped file plus the changes made since it was
+// written. Never modified once published, so queries on the GUI thread and
+// a pass building the next snapshot can share it.
+struct TrigramIndex::Snapshot
+{
+    struct File
+    {
+        QString path;       // relative to the root
+        qint64 modified;
+        qint64 size;
+        quint32 flags;
+        QVector<quint32> trigrams;
+    };
+    
+    std::shared_ptr<const IndexFile> base;
+    QSet<quint32> removed;  // base ids deleted or superseded by changed
+    QVector<File> changed;  // files new or modified since base was written
+};
+
+TrigramIndex::TrigramIndex(QObject* parent)
+    : QObject(parent)
+    , m_isReady(false)
+    , m_isUpdating(false)
+    , m_isWatchLimitReached(false)
+    , m_generation(0)
+    , m_cancelled(std::make_shared<std::atomic<bool>>(false))
+{
+    // One pass at a time, so passes never race to write the index file
+    m_pool.setMaxThreadCount(1);
+    
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(UpdateDelayMs);
+    connect(&m_updateTimer, &QTimer::timeout, this, &TrigramIndex::startUpdate);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &TrigramIndex::onDirectoryChanged);
+}
+
+TrigramIndex::~TrigramIndex()
+{
+    *m_cancelled = true;
+    m_pool.waitForDone();
+}
+
+QString TrigramIndex::getIndexFilePath(const QString& root)
+{
+    QDir dir(AppSettings::getConfigDirectory());
+    if (!dir.exists("search-index"))
+    {
+        dir.mkpath("search-index");
+    }
+    
+    // One file per project, named after a hash of its canonical root
+    QFileInfo rootInfo(root);
+    QString path = rootInfo.canonicalFilePath().isEmpty() ? rootInfo.absoluteFilePath() : rootInfo.canonicalFilePath();
+    QByteArray hash = QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return dir.filePath("search-index/" + QString::fromLatin1(hash) + ".idx");
+}
+
+void TrigramIndex::open(const QString& root)
+{
+    // Abandon the previous project's pass; the pool runs the next one after it
+    *m_cancelled = true;
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+    ++m_generation;
+    
+    m_root = root.isEmpty() ? QString() : QDir(root).absolutePath();
+    m_snapshot.reset();
+    m_isUpdating = false;
+    m_isWatchLimitReached = false;
+    m_pendingDirs.clear();
+    m_updateTimer.stop();
+    if (!m_watcher.directories().isEmpty())
+    {
+        m_watcher.removePaths(m_watcher.directories());
+    }
+    setReady(false);
+    
+    if (!m_root.isEmpty())
+    {
+        // The first pass maps the saved index and checks the whole tree
+        m_pendingDirs.insert(QString());
+        startUpdate();
+    }
+}
+
+void TrigramIndex::onDirectoryChanged(const QString& path)
+{
+    QString relativePath = QDir(m_root).relativeFilePath(path);
+    if (relativePath == ".")
+    {
+        relativePath.clear();
+    }
+    m_pendingDirs.insert(relativePath);
+    
+    // Restarted by every change, so a burst (a checkout, a build) is one pass
+    m_updateTimer.start();
+}
+
+void TrigramIndex::startUpdate()
+{
+    if (m_isUpdating || m_pendingDirs.isEmpty() || m_updateTimer.isActive())
+    {
+        return;
+    }
+    m_isUpdating = true;
+    
+    // Only the outermost changed directories need walking
+    QStringList dirs;
+    for (const QString& dir : m_pendingDirs)
+    {
+        bool covered = false;
+        for (const QString& other : m_pendingDirs)
+        {
+            if (other != dir && isUnder(dir, other))
+            {
+                covered = true;
+                break;
+            }
+        }
+        if (!covered)
+        {
+            dirs.append(dir);
+        }
+    }
+    m_pendingDirs.clear();
+    
+    const QString root = m_root;
+    const int generation = m_generation;
+    std::shared_ptr<const Snapshot> snapshot = m_snapshot;
+    std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+    QPointer<TrigramIndex> guard(this);
+    m_pool.start(QRunnable::create([root, generation, snapshot, dirs, cancelled, guard]() {
+        QStringList directories;
+        std::shared_ptr<const Snapshot> next = update(root, snapshot, dirs, directories, *cancelled);
+        
+        // The guard is only safe to check on the GUI thread, where the index lives
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, generation, next, directories]() {
+            if (guard)
+            {
+                guard->onUpdateFinished(generation, next, directories);
+            }
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void TrigramIndex::onUpdateFinished(int generation, std::shared_ptr<const Snapshot> snapshot,
+                                    const QStringList& directories)
+{
+    if (generation != m_generation)
+    {
+        return;
+    }
+    m_isUpdating = false;
+    
+    if (snapshot)
+    {
+        m_snapshot = snapshot;
+        
+        // Watch the directories walked, as many as the system allows
+        QStringList watched = m_watcher.directories();
+        const QSet<QString> watchedSet(watched.cbegin(), watched.cend());
+        QStringList added;
+        for (const QString& directory : directories)
+        {
+            if (watchedSet.contains(directory))
+            {
+                continue;
+            }
+            if (watched.size() + added.size() >= MaxWatchedDirectories)
+            {
+                m_isWatchLimitReached = true;
+                break;
+            }
+            added.append(directory);
+        }
+        if (!added.isEmpty() && !m_watcher.addPaths(added).isEmpty())
+        {
+            m_isWatchLimitReached = true;
+        }
+        
+        // Files added to an unwatched directory would be missing from the
+        // candidates, so such a project is always searched in full
+        setReady(!m_isWatchLimitReached);
+    }
+    
+    // Changes that came in while this pass ran
+    startUpdate();
+}
+
+void TrigramIndex::setReady(bool isReady)
+{
+    if (m_isReady != isReady)
+    {
+        m_isReady = isReady;
+        emit readyChanged(isReady);
+    }
+}
+
+bool TrigramIndex::isUnder(const QString& path, const QString& dir)
+{
+    return dir.isEmpty() || path == dir || (path.startsWith(dir) && path.at(dir.size()) == '/');
+}
+
+bool TrigramIndex::isModified(const QString& path, qint64 modified, qint64 size)
+{
+    // Deleted files can't match, so only a file still there counts
+    const QFileInfo info(path);
+    return info.exists() && (info.lastModified().toMSecsSinceEpoch() != modified || info.size() != size);
+}
+
+std::shared_ptr<const TrigramIndex::Snapshot> TrigramIndex::update(const QString& root,
+                                                                   std::shared_ptr<const Snapshot> current,
+                                                                   const QStringList& dirs,
+                                                                   QStringList& directories,
+                                                                   const std::atomic<bool>& cancelled)
+{
+    auto next = std::make_shared<Snapshot>();
+    if (current)
+    {
+        *next = *current;
+    }
+    else
+    {
+        next->base = IndexFile::map(getIndexFilePath(root));
+    }
+    
+    // Everything indexed so far, by path
+    struct Known
+    {
+        qint64 modified;
+        qint64 size;
+        qint64 baseId;     // -1 if in changed
+        int changedIndex;  // -1 if in base
+    };
+    QHash<QString, Known> known;
+    if (next->base)
+    {
+        for (quint32 id = 0; id < next->base->fileCount(); ++id)
+        {
+            if (!next->removed.contains(id))
+            {
+                const FileEntry& file = next->base->file(id);
+                known.insert(next->base->path(id), Known{file.modified, file.size, id, -1});
+            }
+        }
+    }
+    for (int i = 0; i < next->changed.size(); ++i)
+    {
+        const Snapshot::File& file = next->changed[i];
+        known.insert(file.path, Known{file.modified, file.size, -1, i});
+    }
+    
+    // Walk the changed directories, noting what is new or modified
+    QSet<QString> seen;
+    QStringList stale;
+    QVector<QFileInfo> staleInfo;
+    for (const QString& dir : dirs)
+    {
+        ProjectWalker::walk(root, dir, [&](const QFileInfo& entry, const QString& relativePath) {
+            seen.insert(relativePath);
+            auto it = known.constFind(relativePath);
+            if (it == known.cend() || it->modified != entry.lastModified().toMSecsSinceEpoch()
+                || it->size != entry.size())
+            {
+                stale.append(relativePath);
+                staleInfo.append(entry);
+            }
+        }, [&directories](const QFileInfo& entry, const QString&) {
+            directories.append(entry.absoluteFilePath());
+        }, cancelled);
+    }
+    if (cancelled)
+    {
+        return nullptr;
+    }
+    
+    // Forget files that are gone or about to be reindexed
+    QSet<int> dropped;
+    auto forget = [&next, &dropped](const Known& entry) {
+        if (entry.baseId >= 0)
+        {
+            next->removed.insert(quint32(entry.baseId));
+        }
+        else
+        {
+            dropped.insert(entry.changedIndex);
+        }
+    };
+    for (auto it = known.cbegin(); it != known.cend(); ++it)
+    {
+        if (seen.contains(it.key()))
+        {
+            continue;
+        }
+        for (const QString& dir : dirs)
+        {
+            if (isUnder(it.key(), dir))
+            {
+                forget(*it);
+                break;
+            }
+        }
+    }
+    for (const QString& path : stale)
+    {
+        auto it = known.constFind(path);
+        if (it != known.cend())
+        {
+            forget(*it);
+        }
+    }
+    if (!dropped.isEmpty())
+    {
+        QVector<Snapshot::File> kept;
+        for (int i = 0; i < next->changed.size(); ++i)
+        {
+            if (!dropped.contains(i))
+            {
+                kept.append(next->changed[i]);
+            }
+        }
+        next->changed.swap(kept);
+    }
+    
+    // Index the new and modified files
+    TrigramSet trigrams;
+    for (int i = 0; i < stale.size(); ++i)
+    {
+        if (cancelled)
+        {
+            return nullptr;
+        }
+        const QFileInfo& entry = staleInfo[i];
+        Snapshot::File file{stale[i], entry.lastModified().toMSecsSinceEpoch(), entry.size(), 0, {}};
+        
+        QFile source(entry.filePath());
+        uchar* data = nullptr;
+        if (file.size > MaxIndexedFileSize || !source.open(QIODevice::ReadOnly)
+            || (file.size > 0 && !(data = source.map(0, file.size))))
+        {
+            file.flags = UnindexedFile;
+        }
+        else if (data)
+        {
+            const char* bytes = reinterpret_cast<const char*>(data);
+            if (std::memchr(bytes, 0, qMin(file.size, BinaryCheckBytes)))
+            {
+                file.flags = BinaryFile;
+            }
+            else
+            {
+                trigrams.add(bytes, file.size);
+                file.trigrams = trigrams.take();
+            }
+            source.unmap(data);
+        }
+        next->changed.append(file);
+    }
+    
+    // Write a new index file on the first build, and once the in-memory
+    // changes grow large enough to slow queries down
+    if (!next->base || next->changed.size() + next->removed.size() > CompactThreshold)
+    {
+        if (std::shared_ptr<const Snapshot> compacted = compact(root, *next))
+        {
+            return compacted;
+        }
+    }
+    return next;
+}
+
+std::shared_ptr<const TrigramIndex::Snapshot> TrigramIndex::compact(const QString& root, const Snapshot& snapshot)
+{
+    // Files that survive keep their order and come first, so renumbered
+    // postings stay ascending; then the changed files
+    QVector<FileEntry> files;
+    QByteArray strings;
+    auto addFile = [&files, &strings](const QString& path, quint32 flags, qint64 modified, qint64 size) {
+        const QByteArray utf8 = path.toUtf8();
+        files.append(FileEntry{quint64(strings.size()), quint32(utf8.size()), flags, modified, size});
+        strings.append(utf8);
+    };
+    
+    const quint32 baseCount = snapshot.base ? snapshot.base->fileCount() : 0;
+    QVector<qint64> newIds(baseCount, -1);
+    for (quint32 id = 0; id < baseCount; ++id)
+    {
+        if (!snapshot.removed.contains(id))
+        {
+            const FileEntry& file = snapshot.base->file(id);
+            newIds[id] = files.size();
+            addFile(snapshot.base->path(id), file.flags, file.modified, file.size);
+        }
+    }
+    const quint32 firstChanged = files.size();
+    for (const Snapshot::File& file : snapshot.changed)
+    {
+        addFile(file.path, file.flags, file.modified, file.size);
+    }
+    
+    QHash<quint32, QVector<quint32>> postings;
+    if (snapshot.base)
+    {
+        for (const TrigramEntry* entry = snapshot.base->trigramsBegin(); entry != snapshot.base->trigramsEnd(); ++entry)
+        {
+            QVector<quint32> ids;
+            const quint32* first = snapshot.base->postings(*entry);
+            for (const quint32* id = first; id != first + entry->count; ++id)
+            {
+                if (*id < baseCount && newIds[*id] >= 0)
+                {
+                    ids.append(quint32(newIds[*id]));
+                }
+            }
+            if (!ids.isEmpty())
+            {
+                postings.insert(entry->trigram, ids);
+            }
+        }
+    }
+    for (int i = 0; i < snapshot.changed.size(); ++i)
+    {
+        for (quint32 trigram : snapshot.changed[i].trigrams)
+        {
+            postings[trigram].append(firstChanged + i);
+        }
+    }
+    
+    QVector<quint32> keys = postings.keys().toVector();
+    std::sort(keys.begin(), keys.end());
+    QVector<TrigramEntry> trigrams;
+    trigrams.reserve(keys.size());
+    quint64 postingCount = 0;
+    for (quint32 trigram : keys)
+    {
+        const quint32 count = postings[trigram].size();
+        trigrams.append(TrigramEntry{trigram, count, postingCount});
+        postingCount += count;
+    }
+    
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = IndexMagic;
+    header.version = IndexVersion;
+    header.fileCount = files.size();
+    header.trigramCount = trigrams.size();
+    header.filesOffset = sizeof(Header);
+    header.trigramsOffset = header.filesOffset + files.size() * sizeof(FileEntry);
+    header.postingsOffset = header.trigramsOffset + trigrams.size() * sizeof(TrigramEntry);
+    header.postingCount = postingCount;
+    header.stringsOffset = header.postingsOffset + postingCount * sizeof(quint32);
+    header.stringsSize = strings.size();
+    
+    // Replaced in one rename, so the mapping a query may still hold stays valid
+    const QString path = getIndexFilePath(root);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return nullptr;
+    }
+    bool written = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header)
+        && file.write(reinterpret_cast<const char*>(files.constData()), files.size() * sizeof(FileEntry))
+               == qint64(files.size() * sizeof(FileEntry))
+        && file.write(reinterpret_cast<const char*>(trigrams.constData()), trigrams.size() * sizeof(TrigramEntry))
+               == qint64(trigrams.size() * sizeof(TrigramEntry));
+    for (auto trigram = keys.cbegin(); written && trigram != keys.cend(); ++trigram)
+    {
+        const QVector<quint32>& ids = postings[*trigram];
+        const qint64 bytes = ids.size() * sizeof(quint32);
+        written = file.write(reinterpret_cast<const char*>(ids.constData()), bytes) == bytes;
+    }
+    written = written && file.write(strings) == strings.size();
+    if (!written || !file.commit())
+    {
+        return nullptr;
+    }
+    
+    auto compacted = std::make_shared<Snapshot>();
+    compacted->base = IndexFile::map(path);
+    if (!compacted->base)
+    {
+        return nullptr;
+    }
+    return compacted;
+}
+
+ProjectSearch::FileSource TrigramIndex::candidates(const QString& pattern, const SearchOptions& options) const
+{
+    if (!isReady() || !m_snapshot)
+    {
+        return nullptr;
+    }
+    const QVector<quint32> trigrams = queryTrigrams(pattern, options);
+    if (trigrams.isEmpty())
+    {
+        return nullptr;
+    }
+    
+    // Snapshots are never modified, so the query can run on the search's pool
+    const QString root = m_root;
+    std::shared_ptr<const Snapshot> snapshot = m_snapshot;
+    return [root, snapshot, trigrams](const std::function<void(const QString&)>& visit,
+                                      const std::atomic<bool>& cancelled) {
+        findCandidates(root, *snapshot, trigrams, visit, cancelled);
+    };
+}
+
+void TrigramIndex::findCandidates(const QString& root, const Snapshot& snapshot, const QVector<quint32>& trigrams,
+                                  const std::function<void(const QString&)>& visit,
+                                  const std::atomic<bool>& cancelled)
+{
+    // The files the trigrams allow come first, so they are being searched
+    // while the rest are checked for changes
+    QVector<quint32> ruledOutIds;
+    QVector<int> ruledOutChanged;
+    if (const IndexFile* base = snapshot.base.get())
+    {
+        // Intersect the posting lists, shortest first so the work shrinks fast
+        QVector<std::pair<const quint32*, const quint32*>> lists;
+        for (quint32 trigram : trigrams)
+        {
+            lists.append(base->find(trigram));
+        }
+        std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+            return a.second - a.first < b.second - b.first;
+        });
+        QVector<quint32> ids(lists[0].first, lists[0].second);
+        for (int i = 1; i < lists.size() && !ids.isEmpty(); ++i)
+        {
+            QVector<quint32> intersection;
+            std::set_intersection(ids.cbegin(), ids.cend(), lists[i].first, lists[i].second,
+                                  std::back_inserter(intersection));
+            ids.swap(intersection);
+        }
+        
+        auto match = ids.cbegin();
+        for (quint32 id = 0; id < base->fileCount(); ++id)
+        {
+            if (snapshot.removed.contains(id))
+            {
+                continue;
+            }
+            while (match != ids.cend() && *match < id)
+            {
+                ++match;
+            }
+            // Files too large to index could hold anything
+            if ((match != ids.cend() && *match == id) || (base->file(id).flags & UnindexedFile))
+            {
+                visit(root + '/' + base->path(id));
+            }
+            else
+            {
+                ruledOutIds.append(id);
+            }
+        }
+    }
+    for (int i = 0; i < snapshot.changed.size(); ++i)
+    {
+        const Snapshot::File& file = snapshot.changed[i];
+        if ((file.flags & UnindexedFile)
+            || std::includes(file.trigrams.cbegin(), file.trigrams.cend(), trigrams.cbegin(), trigrams.cend()))
+        {
+            visit(root + '/' + file.path);
+        }
+        else
+        {
+            ruledOutChanged.append(i);
+        }
+    }
+    
+    // Directory watches don't report files written in place (inotify has no
+    // IN_MODIFY for them), so a file the index rules out is still searched
+    // if it changed since it was indexed. A stat per file costs far less
+    // than reading them all.
+    for (quint32 id : ruledOutIds)
+    {
+        if (cancelled)
+        {
+            return;
+        }
+        const FileEntry& file = snapshot.base->file(id);
+        const QString path = root + '/' + snapshot.base->path(id);
+        if (isModified(path, file.modified, file.size))
+        {
+            visit(path);
+        }
+    }
+    for (int i : ruledOutChanged)
+    {
+        if (cancelled)
+        {
+            return;
+        }
+        const Snapshot::File& file = snapshot.changed[i];
+        const QString path = root + '/' + file.path;
+        if (isModified(path, file.modified, file.size))
+        {
+            visit(path);
+        }
+    }
+}
+
+QVector<quint32> TrigramIndex::queryTrigrams(const QString& pattern, const SearchOptions& options)
+{
+    const QStringList literals = options.regex ? requiredLiterals(pattern) : QStringList{pattern};
+    
+    QVector<quint32> trigrams;
+    for (const QString& literal : literals)
+    {
+        const QByteArray bytes = literal.toUtf8();
+        quint32 trigram = 0;
+        int lastNonAscii = -3;
+        for (int i = 0; i < bytes.size(); ++i)
+        {
+            trigram = ((trigram << 8) | uchar(fold(bytes[i]))) & 0xFFFFFF;
+            if (uchar(bytes[i]) >= 0x80)
+            {
+                lastNonAscii = i;
+            }
+            // The index only folds ASCII, so case-insensitive searches can't
+            // rely on trigrams with other letters in them
+            if (i >= 2 && (options.caseSensitive || lastNonAscii < i - 2))
+            {
+                trigrams.append(trigram);
+            }
+        }
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+QStringList TrigramIndex::requiredLiterals(const QString& regex)
+{
+    QStringList literals;
+    QString run;
+    auto flush = [&literals, &run]() {
+        if (run.size() >= 3)
+        {
+            literals.append(run);
+        }
+        run.clear();
+    };
+    // Index just past the character class starting at i
+    auto skipClass = [&regex](qsizetype i) {
+        ++i;
+        if (i < regex.size() && regex[i] == '^')
+        {
+            ++i;
+        }
+        if (i < regex.size() && regex[i] == ']')
+        {
+            ++i;
+        }
+        while (i < regex.size() && regex[i] != ']')
+        {
+            i += regex[i] == '\\' ? 2 : 1;
+        }
+        return i + 1;
+    };
+    
+    // Index just past the argument of the escape \letter whose argument
+    // starts at i, e.g. the digits of \x41 or the name in \p{Greek}
+    auto skipEscapeArgument = [&regex](QChar letter, qsizetype i) {
+        auto skipWhile = [&regex](qsizetype i, qsizetype maxCount, auto predicate) {
+            for (qsizetype count = 0; i < regex.size() && count < maxCount && predicate(regex[i]); ++count)
+            {
+                ++i;
+            }
+            return i;
+        };
+        auto skipBraces = [&regex](qsizetype i, QChar close) {
+            const qsizetype end = regex.indexOf(close, i);
+            return end < 0 ? regex.size() : end + 1;
+        };
+        const auto isHex = [](QChar c) {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        };
+        const auto isOctal = [](QChar c) { return c >= '0' && c <= '7'; };
+        const auto isDigit = [](QChar c) { return c >= '0' && c <= '9'; };
+        const bool hasBrace = i < regex.size() && regex[i] == '{';
+        
+        switch (letter.unicode())
+        {
+        case 'x':
+            return hasBrace ? skipBraces(i, '}') : skipWhile(i, 2, isHex);
+        case 'o':
+        case 'N':
+            return hasBrace ? skipBraces(i, '}') : i;
+        case 'u':
+            return skipWhile(i, 4, isHex);
+        case '0':
+            return skipWhile(i, 2, isOctal);
+        case 'c':
+            return qMin(i + 1, regex.size());
+        case 'p':
+        case 'P':
+            return hasBrace ? skipBraces(i, '}') : qMin(i + 1, regex.size());
+        case 'g':
+            if (hasBrace)
+            {
+                return skipBraces(i, '}');
+            }
+            if (i < regex.size() && (regex[i] == '<' || regex[i] == '\''))
+            {
+                return skipBraces(i + 1, regex[i] == '<' ? QChar('>') : QChar('\''));
+            }
+            return skipWhile(i < regex.size() && (regex[i] == '-' || regex[i] == '+') ? i + 1 : i, 3, isDigit);
+        case 'k':
+            if (i < regex.size() && (regex[i] == '<' || regex[i] == '{' || regex[i] == '\''))
+            {
+                const QChar open = regex[i];
+                return skipBraces(i + 1, open == '<' ? QChar('>') : open == '{' ? QChar('}') : QChar('\''));
+            }
+            return i;
+        case 'Q':
+        {
+            // Quoted text runs to \E; it is literal, but simpler to skip
+            const qsizetype end = regex.indexOf(QLatin1String("\\E"), i);
+            return end < 0 ? regex.size() : end + 2;
+        }
+        default:
+            // \1 to \9 and up: a back reference or an octal code, all digits
+            return isDigit(letter) ? skipWhile(i, 2, isDigit) : i;
+        }
+    };
+    
+    qsizetype i = 0;
+    while (i < regex.size())
+    {
+        const QChar c = regex[i];
+        
+        // Alternatives at the top level: no literal is required by all of them
+        if (c == '|')
+        {
+            return QStringList();
+        }
+        
+        if (c == '(')
+        {
+            // Inline options such as (?i) or (?x) change how the rest reads
+            if (i + 2 < regex.size() && regex[i + 1] == '?' && (regex[i + 2].isLetter() || regex[i + 2] == '-'))
+            {
+                return QStringList();
+            }
+            // A group may be optional or hold alternatives; skip it whole
+            int depth = 0;
+            while (i < regex.size())
+            {
+                if (regex[i] == '\\')
+                {
+                    i += 2;
+                    continue;
+                }
+                if (regex[i] == '[')
+                {
+                    i = skipClass(i);
+                    continue;
+                }
+                if (regex[i] == '(')
+                {
+                    ++depth;
+                }
+                else if (regex[i] == ')' && --depth == 0)
+                {
+                    ++i;
+                    break;
+                }
+                ++i;
+            }
+            flush();
+            continue;
+        }
+        if (c == '[')
+        {
+            i = skipClass(i);
+            flush();
+            continue;
+        }
+        if (c == '{')
+        {
+            // The quantifier of the atom before, already accounted for
+            const qsizetype close = regex.indexOf('}', i);
+            i = close < 0 ? regex.size() : close + 1;
+            flush();
+            continue;
+        }
+        
+        QChar literal = c;
+        qsizetype next = i + 1;
+        if (c == '\\')
+        {
+            if (next >= regex.size())
+            {
+                break;
+            }
+            literal = regex[next++];
+            // Escaped letters and digits are classes, anchors, back references
+            // or character codes; skip whatever argument they take too
+            if (literal.isLetterOrNumber())
+            {
+                flush();
+                i = skipEscapeArgument(literal, next);
+                continue;
+            }
+        }
+        else if (c == '.' || c == '^' || c == '$' || c == '*' || c == '+' || c == '?' || c == ')')
+        {
+            flush();
+            i = next;
+            continue;
+        }
+        
+        // A quantifier after the literal decides whether it is required
+        const QChar quantifier = next < regex.size() ? regex[next] : QChar();
+        const bool optional = quantifier == '?' || quantifier == '*'
+            || (quantifier == '{' && next + 1 < regex.size() && (regex[next + 1] == '0' || regex[next + 1] == ','));
+        if (!optional)
+        {
+            run.append(literal);
+        }
+        if (optional || quantifier == '+' || quantifier == '{')
+        {
+            flush();
+        }
+        i = next;
+    }
+    flush();
+    return literals;
+}
@@ -0,0 +1,160 @@
+#include "terminal/CellStyle.hpp"
+
+using namespace openide::terminal;
+
+namespace
+{
+// Parse the color following 38 or 48 at params[i]: 5;n for an indexed
+// color or 2;r;g;b for a direct one. Advances i past what it used.
+bool parseExtendedColor(const int* params, int count, int& i, quint32& color)
+{
+    if (i + 1 >= count)
+    {
+        return false;
+    }
+    if (params[i + 1] == 5 && i + 2 < count)
+    {
+        const int index = params[i + 2];
+        i += 2;
+        if (index < 0 || index > 255)
+        {
+            return false;
+        }
+        color = CellStyle::IndexedColor | quint32(index);
+        return true;
+    }
+    if (params[i + 1] == 2 && i + 4 < count)
+    {
+        const int r = qBound(0, params[i + 2], 255);
+        const int g = qBound(0, params[i + 3], 255);
+        const int b = qBound(0, params[i + 4], 255);
+        i += 4;
+        color = CellStyle::RgbColor | (quint32(r) << 16) | (quint32(g) << 8) | quint32(b);
+        return true;
+    }
+    // Unknown color space: skip the rest, as its length can't be known
+    i = count;
+    return false;
+}
+}
+
+void CellStyle::applySgr(const int* params, int count)
+{
+    // ESC [ m is a reset
+    if (count == 0)
+    {
+        *this = CellStyle();
+        return;
+    }
+    
+    for (int i = 0; i < count; ++i)
+    {
+        const int param = params[i] < 0 ? 0 : params[i];
+        switch (param)
+        {
+        case 0:
+            *this = CellStyle();
+            break;
+        case 1:
+            attributes |= Bold;
+            break;
+        case 2:
+            attributes |= Dim;
+            break;
+        case 3:
+            attributes |= Italic;
+            break;
+        case 4:
+            attributes |= Underline;
+            break;
+        case 7:
+            attributes |= Inverse;
+            break;
+        case 9:
+            attributes |= Strikeout;
+            break;
+        case 22:
+            attributes &= ~(Bold | Dim);
+            break;
+        case 23:
+            attributes &= ~Italic;
+            break;
+        case 24:
+            attributes &= ~Underline;
+            break;
+        case 27:
+            attributes &= ~Inverse;
+            break;
+        case 29:
+            attributes &= ~Strikeout;
+            break;
+        case 38:
+            parseExtendedColor(params, count, i, foreground);
+            break;
+        case 39:
+            foreground = DefaultColor;
+            break;
+        case 48:
+            parseExtendedColor(params, count, i, background);
+            break;
+        case 49:
+            background = DefaultColor;
+            break;
+        default:
+            if (param >= 30 && param <= 37)
+            {
+                foreground = IndexedColor | quint32(param - 30);
+            }
+            else if (param >= 40 && param <= 47)
+            {
+                background = IndexedColor | quint32(param - 40);
+            }
+            else if (param >= 90 && param <= 97)
+            {
+                foreground = IndexedColor | quint32(param - 90 + 8);
+            }
+            else if (param >= 100 && param <= 107)
+            {
+                background = IndexedColor | quint32(param - 100 + 8);
+            }
+            // Blinking, fonts and the like are ignored
+            break;
+        }
+    }
+}
+
+QColor CellStyle::color(quint32 encoded, const QColor& fallback)
+{
+    switch (encoded & 0xff000000)
+    {
+    case IndexedColor:
+        return indexedColor(int(encoded & 0xff));
+    case RgbColor:
+        return QColor::fromRgb(encoded & 0x00ffffff);
+    default:
+        return fallback;
+    }
+}
+
+QColor CellStyle::indexedColor(int index)
+{
+    // The 16 basic colors as xterm draws them
+    static const QRgb basic[16] = {
+        0x000000, 0xcd0000, 0x00cd00, 0xcdcd00, 0x0000ee, 0xcd00cd, 0x00cdcd, 0xe5e5e5,
+        0x7f7f7f, 0xff0000, 0x00ff00, 0xffff00, 0x5c5cff, 0xff00ff, 0x00ffff, 0xffffff
+    };
+    if (index < 16)
+    {
+        return QColor::fromRgb(basic[qMax(0, index)]);
+    }
+    if (index < 232)
+    {
+        // 6x6x6 color cube
+        static const int levels[6] = { 0, 95, 135, 175, 215, 255 };
+        const int cube = index - 16;
+        return QColor(levels[cube / 36], levels[(cube / 6) % 6], levels[cube % 6]);
+    }
+    // 24 step grayscale ramp
+    const int level = 8 + (qMin(index, 255) - 232) * 10;
+    return QColor(level, level, level);
+}
@@ -0,0 +1,184 @@
+#include "terminal/Scrollback.hpp"
+
+using namespace openide::terminal;
+
+Scrollback::Scrollback(int capacity)
+    : m_first(0)
+    , m_count(1)
+    , m_capacity(qMax(1, capacity))
+{
+    m_lines.append(Line());
+}
+
+void Scrollback::setCapacity(int capacity)
+{
+    capacity = qMax(1, capacity);
+    if (capacity == m_capacity)
+    {
+        return;
+    }
+    
+    // Lay the newest lines out from slot 0 again, so the ring can grow
+    const int kept = qMin(m_count, capacity);
+    QVector<Line> lines;
+    lines.reserve(kept);
+    for (int i = m_count - kept; i < m_count; ++i)
+    {
+        lines.append(std::move(m_lines[slot(i)]));
+    }
+    m_lines = std::move(lines);
+    m_first = 0;
+    m_count = kept;
+    m_capacity = capacity;
+}
+
+bool Scrollback::newLine()
+{
+    if (m_count < m_capacity)
+    {
+        // Not full yet, so the lines fill the slots in order
+        m_lines.append(Line());
+        ++m_count;
+        return false;
+    }
+    
+    // Full: the oldest line's slot becomes the newest, keeping its buffers
+    Line& reused = m_lines[m_first];
+    reused.text.truncate(0);
+    reused.spans.resize(0);
+    m_first = (m_first + 1) % m_lines.size();
+    return true;
+}
+
+void Scrollback::clear()
+{
+    m_first = 0;
+    m_count = 1;
+    m_lines.resize(1);
+    m_lines[0] = Line();
+}
+
+void Scrollback::write(int column, const QChar* text, qsizetype length, const CellStyle& style)
+{
+    if (length <= 0)
+    {
+        return;
+    }
+    Line& line = last();
+    if (column > line.text.size())
+    {
+        const int end = int(line.text.size());
+        line.text.resize(column, QLatin1Char(' '));
+        applyStyle(line, end, column, CellStyle());
+    }
+    
+    // Overwrite what is under the cursor and append the rest
+    const qsizetype overwritten = qMin<qsizetype>(length, line.text.size() - column);
+    line.text.replace(column, overwritten, text, length);
+    applyStyle(line, column, column + int(length), style);
+}
+
+void Scrollback::truncate(int column)
+{
+    Line& line = last();
+    if (column >= line.text.size())
+    {
+        return;
+    }
+    line.text.truncate(column);
+    while (!line.spans.isEmpty() && line.spans.last().start >= column)
+    {
+        line.spans.removeLast();
+    }
+}
+
+void Scrollback::remove(int column, int count)
+{
+    Line& line = last();
+    if (column >= line.text.size() || count <= 0)
+    {
+        return;
+    }
+    const int removed = qMin(count, int(line.text.size()) - column);
+    const CellStyle following = styleAt(line, column + removed);
+    line.text.remove(column, removed);
+    
+    // Spans in the removed text collapse onto column, later ones shift
+    int kept = 0;
+    int insertAt = 0;
+    for (int i = 0; i < line.spans.size(); ++i)
+    {
+        StyleSpan span = line.spans[i];
+        if (span.start < column)
+        {
+            line.spans[kept++] = span;
+            insertAt = kept;
+        }
+        else if (span.start >= column + removed)
+        {
+            span.start -= removed;
+            line.spans[kept++] = span;
+        }
+    }
+    line.spans.resize(kept);
+    if (column < line.text.size() && styleAt(line, column) != following)
+    {
+        line.spans.insert(insertAt, StyleSpan{column, following});
+    }
+}
+
+void Scrollback::setDefaultForeground(quint32 foreground)
+{
+    Line& line = last();
+    if (line.spans.isEmpty() || line.spans.first().start > 0)
+    {
+        line.spans.prepend(StyleSpan{0, CellStyle()});
+    }
+    for (StyleSpan& span : line.spans)
+    {
+        if (span.style.foreground == CellStyle::DefaultColor)
+        {
+            span.style.foreground = foreground;
+        }
+    }
+}
+
+void Scrollback::applyStyle(Line& line, int from, int to, const CellStyle& style)
+{
+    // Text is mostly written at the end of the line, so search from the back
+    const CellStyle following = styleAt(line, to);
+    int first = line.spans.size();
+    while (first > 0 && line.spans[first - 1].start >= from)
+    {
+        --first;
+    }
+    int last = first;
+    while (last < line.spans.size() && line.spans[last].start <= to)
+    {
+        ++last;
+    }
+    line.spans.remove(first, last - first);
+    
+    const CellStyle preceding = first > 0 ? line.spans[first - 1].style : CellStyle();
+    int insertAt = first;
+    if (preceding != style)
+    {
+        line.spans.insert(insertAt++, StyleSpan{from, style});
+    }
+    if (to < line.text.size() && following != style)
+    {
+        line.spans.insert(insertAt, StyleSpan{to, following});
+    }
+}
+
+CellStyle Scrollback::styleAt(const Line& line, int column)
+{
+    for (int i = line.spans.size() - 1; i >= 0; --i)
+    {
+        if (line.spans[i].start <= column)
+        {
+            return line.spans[i].style;
+        }
+    }
+    return CellStyle();
+}
@@ -1,6 +1,6 @@
 #include "terminal/TerminalBackendInterface.hpp"
-#include <QRegularExpression>
 #include <QDir>
+#include <QTimer>
 
 using namespace openide::terminal;
 
@@ -8,105 +8,37 @@ using namespace openide::terminal;
 TerminalBackendInterface::TerminalBackendInterface()
     : m_isInitialized(false)
     , m_workingDirectory()
+    , m_process(nullptr)
+    , m_isCancelling(false)
 {
 }
 
-// Close - default implementation
+// Close - default implementation, stops the running command
 void TerminalBackendInterface::close()
 {
+    if (m_process) {
+        QProcess* process = m_process;
+        m_process = nullptr;
+        disconnect(process, nullptr, this, nullptr);
+        process->kill();
+        process->waitForFinished(1000);
+        delete process;
+    }
     m_isInitialized = false;
 }
 
-// Common output cleaning function - removes ANSI escape sequences and control characters
-QString TerminalBackendInterface::cleanTerminalOutput(const QString& output)
+// Without a session, input goes to the running command
+void TerminalBackendInterface::writeInput(const QByteArray& data)
 {
-    if (output.isEmpty()) {
-        return output;
-    }
-    
-    QString cleaned;
-    cleaned.reserve(output.length());
-    
-    bool inEscapeSequence = false;
-    bool inCsiSequence = false; // Control Sequence Introducer
-    
-    for (int i = 0; i < output.length(); ++i) {
-        QChar c = output[i];
-        unsigned short ch = c.unicode();
-        
-        // Handle ANSI escape sequences
-        if (inEscapeSequence) {
-            if (ch == '[') {
-                inCsiSequence = true;
-                continue;
-            } else if (inCsiSequence) {
-                // CSI sequence: ESC[ followed by parameters and a command character
-                // Command characters are typically in range 0x40-0x7E
-                if (ch >= 0x40 && ch <= 0x7E) {
-                    // End of CSI sequence
-                    inEscapeSequence = false;
-                    inCsiSequence = false;
-                }
-                // Skip all characters in the CSI sequence
-                continue;
-            } else if (ch == 0x1B) {
-                // Another escape character, continue
-                continue;
-            } else if ((ch >= 0x40 && ch <= 0x5F) || (ch >= 0x60 && ch <= 0x7E)) {
-                // Two-character escape sequence (ESC followed by a command character)
-                inEscapeSequence = false;
-                continue;
-            } else {
-                // Continue in escape sequence
-                continue;
-            }
-        }
-        
-        // Check for escape character (0x1B or \033)
-        if (ch == 0x1B) {
-            inEscapeSequence = true;
-            continue;
-        }
-        
-        // Filter control characters, but keep useful ones
-        if (ch < 0x20) {
-            // Keep newline, carriage return, and tab
-            if (ch == '\n' || ch == '\r' || ch == '\t') {
-                cleaned.append(c);
-            }
-            // Skip all other control characters (BEL, BS, etc.)
-            continue;
-        }
-        
-        // Remove DEL character
-        if (ch == 0x7F) {
-            continue;
-        }
-        
-        // Keep printable ASCII characters (0x20-0x7E) and valid UTF-8 sequences
-        // For extended characters, we'll keep them as they might be valid UTF-8
-        if (ch >= 0x20 && ch <= 0x7E) {
-            // Standard ASCII printable
-            cleaned.append(c);
-        } else if (ch > 0x7F) {
-            // Extended character - keep it (might be UTF-8)
-            cleaned.append(c);
-        }
+    if (m_process) {
+        m_process->write(data);
     }
-    
-    // Normalize line endings (convert \r\n to \n, standalone \r to \n)
-    cleaned.replace("\r\n", "\n");
-    cleaned.replace('\r', '\n');
-    
-    // Remove excessive blank lines (more than 2 consecutive newlines)
-    while (cleaned.contains("\n\n\n")) {
-        cleaned.replace("\n\n\n", "\n\n");
-    }
-    
-    // Trim leading and trailing whitespace, but preserve structure
-    cleaned = cleaned.trimmed();
-    
-    return cleaned;
+}
+
+void TerminalBackendInterface::setTerminalSize(int columns, int rows)
+{
+    Q_UNUSED(columns);
+    Q_UNUSED(rows);
 }
 
 // Platform-specific output cleaning - default implementation does nothing
@@ -115,15 +47,15 @@ QString TerminalBackendInterface::platformSpecificCleanOutput(const QString& out
     return output;
 }
 
-// Common helper to execute a process and return output
-QString TerminalBackendInterface::executeProcess(const QString& program, const QStringList& arguments, const QString& workingDirectory)
+// Common helper to start a process without blocking the GUI thread
+bool TerminalBackendInterface::startProcess(const QString& program, const QStringList& arguments, const QString& workingDirectory)
 {
-    if (!m_isInitialized) {
-        return QString("Error: Terminal not initialized. Call init() first.");
+    if (!m_isInitialized || isCommandRunning()) {
+        return false;
     }
     
     // Create a new QProcess for this command
-    QProcess process;
+    QProcess* process = new QProcess(this);
     
     // Set the working directory if provided
     QString actualWorkingDir = workingDirectory;
@@ -132,43 +64,80 @@ QString TerminalBackendInterface::executeProcess(const QString& program, const Q
     }
     
     if (!actualWorkingDir.isEmpty()) {
-        process.setWorkingDirectory(actualWorkingDir);
+        process->setWorkingDirectory(actualWorkingDir);
         m_workingDirectory = actualWorkingDir;
     }
     
     // Set process channel mode to merge stdout and stderr
-    process.setProcessChannelMode(QProcess::MergedChannels);
-    
-    // Start the process
-    process.start(program, arguments);
-    
-    // Wait for the process to finish (with timeout)
-    if (!process.waitForFinished(30000)) {
-        // Process timed out or failed to start
-        if (process.state() == QProcess::Running) {
-            process.kill();
-            process.waitForFinished(1000);
-        }
-        return QString("Error: Command execution timed out or failed to start.");
-    }
-    
-    // Read the output
-    QByteArray output = process.readAllStandardOutput();
-    QString result;
+    process->setProcessChannelMode(QProcess::MergedChannels);
     
     // Use UTF-8 for Unix, Local8Bit for Windows
 #ifdef WIN32
-    result = QString::fromLocal8Bit(output);
+    m_processDecoder = QStringDecoder(QStringDecoder::System);
 #else
-    result = QString::fromUtf8(output);
+    m_processDecoder = QStringDecoder(QStringDecoder::Utf8);
 #endif
+    m_process = process;
+    m_isCancelling = false;
+    
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, process]() {
+        forwardProcessOutput(process);
+    });
+    connect(process, &QProcess::finished, this, [this, process](int exitCode, QProcess::ExitStatus exitStatus) {
+        finishProcess(process, exitStatus == QProcess::NormalExit ? exitCode : -1);
+    });
+    connect(process, &QProcess::errorOccurred, this, [this, process, program](QProcess::ProcessError error) {
+        // A process that never started won't report finished
+        if (error == QProcess::FailedToStart) {
+            emit outputReceived(QString("Error: Failed to start %1: %2\n").arg(program, process->errorString()).toUtf8());
+            finishProcess(process, -1);
+        }
+    });
     
-    // Clean the output using common cleaning
-    result = cleanTerminalOutput(result);
-    
-    // Apply platform-specific cleaning
-    result = platformSpecificCleanOutput(result);
-    
-    return result;
+    process->start(program, arguments);
+    return true;
 }
 
+void TerminalBackendInterface::forwardProcessOutput(QProcess* process)
+{
+    if (process != m_process) {
+        return;
+    }
+    // The decoder keeps multi-byte characters split across reads
+    const QString output = platformSpecificCleanOutput(m_processDecoder.decode(process->readAllStandardOutput()));
+    if (!output.isEmpty()) {
+        emit outputReceived(output.toUtf8());
+    }
+}
+
+void TerminalBackendInterface::finishProcess(QProcess* process, int exitCode)
+{
+    if (process != m_process) {
+        return;
+    }
+    forwardProcessOutput(process);
+    m_process = nullptr;
+    process->deleteLater();
+    
+    if (m_isCancelling) {
+        emit commandCancelled();
+    } else {
+        emit commandFinished(exitCode);
+    }
+}
+
+// Interrupt - ask the running command to stop, then kill it if it doesn't
+void TerminalBackendInterface::interrupt()
+{
+    if (!isCommandRunning() || m_isCancelling) {
+        return;
+    }
+    m_isCancelling = true;
+    m_process->terminate();
+    
+    // Console programs on Windows don't react to terminate at all
+    QProcess* process = m_process;
+    QTimer::singleShot(CancelGraceMs, process, [process]() {
+        process->kill();
+    });
+}
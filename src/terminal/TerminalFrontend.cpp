@@ -4,7 +4,9 @@
 #include "AppSettings.hpp"
 #include <QPainter>
 #include <QFont>
-#include <QFontMetrics>
+#include <QFontMetricsF>
+#include <QPaintEvent>
+#include <QtMath>
 #include <QShowEvent>
 #include <QLineEdit>
 #include <QVBoxLayout>
@@ -23,9 +25,13 @@ using namespace openide::terminal;
 TerminalFrontend::TerminalFrontend(MainWindow* parent, TerminalBackendInterface* backend)
     : QAbstractScrollArea(parent->getCentralWidget())
     , m_mainWindow(parent)
-    , m_backend(backend)
-    , m_output()
+    , m_backend(nullptr)
+    , m_scrollback()
     , m_currentDirectory()
+    , m_parser(this)
+    , m_cursorColumn(0)
+    , m_backgroundColor(0x1e, 0x1e, 0x1e)
+    , m_isSessionEnded(false)
     , m_inputLine(nullptr)
     , m_inputContainer(nullptr)
     , m_headerBar(nullptr)
@@ -34,6 +40,12 @@ TerminalFrontend::TerminalFrontend(MainWindow* parent, TerminalBackendInterface*
     , m_isCollapsed(false)
     , m_originalHeight(0)
     , m_fontSize(10)
+    , m_cellWidth(1)
+    , m_lineHeight(1)
+    , m_descent(0)
+    , m_repaintTimer()
+    , m_firstDamagedLine(-1)
+    , m_droppedLines(0)
 {
     // Get initial font size from settings if available
     if (m_mainWindow && m_mainWindow->getAppSettings()) {
@@ -43,6 +55,15 @@ TerminalFrontend::TerminalFrontend(MainWindow* parent, TerminalBackendInterface*
             m_fontSize = size;
         }
     }
+    for (QCache<QString, QStaticText>& cache : m_textCaches) {
+        cache.setMaxCost(TextCacheSize);
+    }
+    updateFontMetrics();
+    
+    m_repaintTimer.setSingleShot(true);
+    m_repaintTimer.setInterval(FrameIntervalMs);
+    connect(&m_repaintTimer, &QTimer::timeout, this, &TerminalFrontend::repaintOutput);
+    
     // Set background color for terminal
     setStyleSheet("background-color: #1e1e1e; color: #d4d4d4;");
     
@@ -147,11 +168,22 @@ TerminalFrontend::TerminalFrontend(MainWindow* parent, TerminalBackendInterface*
     
     // Install event filter on viewport to catch wheel events for Ctrl+Scroll
     viewport()->installEventFilter(this);
+    
+    setBackend(backend);
 }
 
 void TerminalFrontend::setBackend(TerminalBackendInterface* backend)
 {
+    if (m_backend) {
+        disconnect(m_backend, nullptr, this, nullptr);
+    }
     m_backend = backend;
+    if (m_backend) {
+        connect(m_backend, &TerminalBackendInterface::outputReceived, this, &TerminalFrontend::onOutputReceived);
+        connect(m_backend, &TerminalBackendInterface::commandFinished, this, &TerminalFrontend::onCommandFinished);
+        connect(m_backend, &TerminalBackendInterface::commandCancelled, this, &TerminalFrontend::onCommandCancelled);
+        connect(m_backend, &TerminalBackendInterface::sessionFinished, this, &TerminalFrontend::onSessionFinished);
+    }
 }
 
 void TerminalFrontend::init()
@@ -162,18 +194,39 @@ void TerminalFrontend::init()
     }
     
     // Initialize the backend
+    updateTerminalSize();
     m_backend->init();
+    updateSessionMode();
     
     // Show welcome message
     appendOutput("Terminal ready. Type commands and press Enter to execute.\n");
     updatePrompt();
 }
 
+void TerminalFrontend::updateSessionMode()
+{
+    if (m_promptLabel) {
+        m_promptLabel->setVisible(!m_backend || !m_backend->hasSession());
+    }
+}
+
+void TerminalFrontend::updateTerminalSize()
+{
+    if (!m_backend) {
+        return;
+    }
+    int availableWidth = viewport()->width() - 20; // left and right margins
+    int columns = int(availableWidth / m_cellWidth);
+    int rows = outputRect().height() / m_lineHeight;
+    m_backend->setTerminalSize(qMax(columns, 20), qMax(rows, 5));
+}
+
 void TerminalFrontend::updateTheme(bool isDarkTheme)
 {
     if (isDarkTheme) {
         // Dark theme colors
         setStyleSheet("background-color: #1e1e1e; color: #d4d4d4;");
+        m_backgroundColor = QColor(0x1e, 0x1e, 0x1e);
         if (m_inputContainer) {
             m_inputContainer->setStyleSheet("background-color: #1e1e1e;");
         }
@@ -224,6 +277,7 @@ void TerminalFrontend::updateTheme(bool isDarkTheme)
     } else {
         // Light theme colors
         setStyleSheet("background-color: #ffffff; color: #000000;");
+        m_backgroundColor = QColor(0xff, 0xff, 0xff);
         if (m_inputContainer) {
             m_inputContainer->setStyleSheet("background-color: #ffffff;");
         }
@@ -314,7 +368,7 @@ void TerminalFrontend::showEvent(QShowEvent* event)
     }
     
     // Initialize terminal when first shown
-    if (m_output.isEmpty() && m_backend) {
+    if (m_scrollback.isEmpty() && m_backend) {
         init();
     }
 }
@@ -346,14 +400,29 @@ void TerminalFrontend::resizeEvent(QResizeEvent* event)
         QRect rect = viewport()->rect();
         int inputHeight = m_inputContainer->sizeHint().height();
         m_inputContainer->setGeometry(0, rect.height() - inputHeight, rect.width(), inputHeight);
+        updateTerminalSize();
     }
+    updateScrollRange();
 }
 
 bool TerminalFrontend::eventFilter(QObject* obj, QEvent* event)
 {
     if (obj == m_inputLine && event->type() == QEvent::KeyPress) {
         QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
-        // Handle special keys if needed
+        // Ctrl+C interrupts whatever is running, unless it is copying a
+        // selection in the input line. Qt calls the Control key Meta on macOS.
+#ifdef Q_OS_MACOS
+        const Qt::KeyboardModifier controlModifier = Qt::MetaModifier;
+#else
+        const Qt::KeyboardModifier controlModifier = Qt::ControlModifier;
+#endif
+        if (keyEvent->key() == Qt::Key_C && keyEvent->modifiers() == controlModifier
+            && !m_inputLine->hasSelectedText() && m_backend
+            && (m_backend->hasSession() || m_backend->isCommandRunning())) {
+            m_inputLine->clear();
+            m_backend->interrupt();
+            return true;
+        }
         return QAbstractScrollArea::eventFilter(obj, event);
     }
     
@@ -401,6 +470,37 @@ bool TerminalFrontend::eventFilter(QObject* obj, QEvent* event)
 
 void TerminalFrontend::onCommandEntered()
 {
+    // Start a new shell if the last one exited
+    if (m_backend && m_isSessionEnded) {
+        m_isSessionEnded = false;
+        m_backend->init();
+        updateSessionMode();
+    }
+    
+    if (m_backend && m_backend->hasSession()) {
+        // The shell echoes what it is sent and prints its own prompt. Blank
+        // lines go through too, e.g. to accept a default answer.
+        QString input = m_inputLine->text();
+        m_inputLine->clear();
+        if (input.trimmed().compare("clear", Qt::CaseInsensitive) == 0) {
+            clearOutput();
+            // An empty line just gets a fresh prompt
+            input.clear();
+        }
+        m_backend->writeInput(input.toUtf8() + '\r');
+        return;
+    }
+    
+    if (m_backend && m_backend->isCommandRunning()) {
+        // Lines typed while a command runs are its input; nothing echoes
+        // them, so show them here
+        QString input = m_inputLine->text();
+        m_inputLine->clear();
+        appendOutput(input + "\n");
+        m_backend->writeInput(input.toUtf8() + '\n');
+        return;
+    }
+    
     QString command = m_inputLine->text().trimmed();
     if (command.isEmpty()) {
         return;
@@ -439,13 +539,7 @@ void TerminalFrontend::executeUserCommand(const QString& command)
     
     // Handle clear command specially to clear the output (before showing the command)
     if (command.compare("clear", Qt::CaseInsensitive) == 0) {
-        m_output.clear();
-        update();
-        // Reset scroll position
-        QScrollBar* vbar = verticalScrollBar();
-        if (vbar) {
-            vbar->setValue(0);
-        }
+        clearOutput();
         return;
     }
     
@@ -508,61 +602,321 @@ void TerminalFrontend::executeUserCommand(const QString& command)
             expandedCommand.replace(QRegularExpression(R"((\s)~(\s|/|$))"), "\\1" + homePath + "\\2");
         }
         
-        // Execute the command with the current working directory using the interface
-        QString result = m_backend->executeCommand(expandedCommand, m_currentDirectory);
-        
-        // Append the result (even if empty, to show command was executed)
-        if (!result.isEmpty()) {
-            appendOutput(result);
-            if (!result.endsWith('\n')) {
-                appendOutput("\n");
-            }
-        } else {
-            // No output - might be a silent command, add a newline for spacing
-            appendOutput("\n");
+        // Start the command with the current working directory using the
+        // interface. Its output streams in through onOutputReceived and
+        // onCommandFinished ends it.
+        if (!m_backend->startCommand(expandedCommand, m_currentDirectory)) {
+            appendOutput("Error: Could not start the command.\n");
+            updatePrompt();
         }
-        
-        // Don't reset the directory - keep the tracked directory
-        // Only update if the command actually changed directories (handled by cd command)
-        updatePrompt();
     }
 }
 
 void TerminalFrontend::appendOutput(const QString& text)
 {
-    m_output += text;
-    
-    // Calculate scroll range before updating
-    QFont font("Consolas", 10);
-    QFontMetrics fm(font);
-    int lineHeight = fm.height();
-    QRect viewportRect = viewport()->rect();
-    
-    // Account for header bar at top (30px height + 2px top margin = 32px)
-    int headerHeight = m_headerBar ? 32 : 0;
+    // Our own text is plain, whatever style the stream left set
+    const CellStyle streamStyle = m_style;
+    m_style = CellStyle();
+    qsizetype start = 0;
+    for (;;) {
+        qsizetype end = text.indexOf('\n', start);
+        print(text.constData() + start, (end < 0 ? text.size() : end) - start);
+        if (end < 0) {
+            break;
+        }
+        newLine();
+        start = end + 1;
+    }
+    m_style = streamStyle;
     
-    int inputHeight = m_inputContainer ? m_inputContainer->height() : 0;
-    int availableHeight = viewportRect.height() - inputHeight - headerHeight;
+    outputChanged();
+}
+
+void TerminalFrontend::outputChanged()
+{
+    // A command can print thousands of lines a second; draw them once per
+    // frame rather than once per read
+    if (!m_repaintTimer.isActive()) {
+        m_repaintTimer.start();
+    }
+}
+
+void TerminalFrontend::repaintOutput()
+{
+    const QRect area = outputRect();
     
-    int totalLines = 0;
-    if (!m_output.isEmpty()) {
-        totalLines = m_output.split('\n').count();
+    // Once the scrollback is full the content stops growing and new lines
+    // push the rest up instead, so move what is already drawn along
+    if (m_droppedLines > 0) {
+        viewport()->scroll(0, -m_droppedLines * m_lineHeight, area);
+        m_droppedLines = 0;
     }
-    // No placeholder text - keep it blank when empty
-    int totalContentHeight = totalLines * lineHeight + 20;
     
-    // Update scroll range
+    // Auto-scroll to bottom; scrollContentsBy moves the rows in view
+    updateScrollRange();
     QScrollBar* vbar = verticalScrollBar();
     if (vbar) {
-        vbar->setRange(0, qMax(0, totalContentHeight - availableHeight));
-        vbar->setPageStep(availableHeight);
-        vbar->setSingleStep(lineHeight);
-        
-        // Auto-scroll to bottom
         vbar->setValue(vbar->maximum());
     }
     
-    update();
+    // Everything from the first changed line down may differ
+    if (m_firstDamagedLine >= 0) {
+        const int top = qMax(area.top(), lineTop(m_firstDamagedLine));
+        if (top <= area.bottom()) {
+            viewport()->update(QRect(area.left(), top, area.width(), area.bottom() - top + 1));
+        }
+        m_firstDamagedLine = -1;
+    }
+}
+
+void TerminalFrontend::damageLine(int line)
+{
+    if (m_firstDamagedLine < 0 || line < m_firstDamagedLine) {
+        m_firstDamagedLine = line;
+    }
+}
+
+void TerminalFrontend::updateScrollRange()
+{
+    QScrollBar* vbar = verticalScrollBar();
+    if (!vbar) {
+        return;
+    }
+    // The scrollback keeps count, so this doesn't depend on how much there is
+    const int availableHeight = outputRect().height();
+    const int totalContentHeight = m_scrollback.lineCount() * m_lineHeight + 20; // Add some padding
+    vbar->setRange(0, qMax(0, totalContentHeight - availableHeight));
+    vbar->setPageStep(availableHeight);
+    vbar->setSingleStep(m_lineHeight);
+}
+
+QRect TerminalFrontend::outputRect() const
+{
+    // Account for header bar at top (30px height + 2px top margin = 32px)
+    // and the input container at the bottom
+    const int headerHeight = m_headerBar ? 32 : 0;
+    const int inputHeight = m_inputContainer ? m_inputContainer->height() : 0;
+    const QRect viewportRect = viewport()->rect();
+    return QRect(0, headerHeight, viewportRect.width(), qMax(0, viewportRect.height() - inputHeight - headerHeight));
+}
+
+int TerminalFrontend::lineTop(int line) const
+{
+    // Rows are placed so that line i's baseline sits lineHeight * (i + 1)
+    // below the top of the output
+    const int scrollOffset = verticalScrollBar() ? verticalScrollBar()->value() : 0;
+    return outputRect().top() + m_descent + line * m_lineHeight - scrollOffset;
+}
+
+void TerminalFrontend::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    // Move the rows already drawn and only paint the ones scrolled into view,
+    // leaving the header bar and input line where they are
+    viewport()->scroll(0, dy, outputRect());
+}
+
+void TerminalFrontend::onOutputReceived(const QByteArray& data)
+{
+    // The parser keeps sequences and characters split across reads
+    m_parser.feed(data);
+    outputChanged();
+}
+
+void TerminalFrontend::onCommandFinished(int exitCode)
+{
+    resetOutputStream();
+    ensureNewline();
+    if (exitCode != 0) {
+        appendOutput(QString("Exited with code %1\n").arg(exitCode));
+    }
+    // Don't reset the directory - keep the tracked directory
+    // Only update if the command actually changed directories (handled by cd command)
+    updatePrompt();
+}
+
+void TerminalFrontend::onCommandCancelled()
+{
+    resetOutputStream();
+    ensureNewline();
+    appendOutput("Command cancelled.\n");
+    updatePrompt();
+}
+
+void TerminalFrontend::onSessionFinished(int exitCode)
+{
+    resetOutputStream();
+    m_isSessionEnded = true;
+    updateSessionMode();
+    ensureNewline();
+    appendOutput(QString("Shell exited with code %1. Enter a command to start a new one.\n").arg(exitCode));
+}
+
+void TerminalFrontend::resetOutputStream()
+{
+    m_parser.reset();
+    m_style = CellStyle();
+}
+
+void TerminalFrontend::ensureNewline()
+{
+    if (!m_scrollback.lastLine().text.isEmpty()) {
+        newLine();
+        outputChanged();
+    }
+    m_cursorColumn = 0;
+}
+
+void TerminalFrontend::print(const QChar* text, qsizetype length)
+{
+    m_scrollback.write(m_cursorColumn, text, length, m_style);
+    m_cursorColumn += int(length);
+    damageLine(m_scrollback.lineCount() - 1);
+}
+
+void TerminalFrontend::execute(char control)
+{
+    switch (control) {
+    case '\n':
+    case '\v':
+    case '\f':
+        newLine();
+        break;
+    case '\r':
+        m_cursorColumn = 0;
+        break;
+    case '\b':
+        m_cursorColumn = qMax(0, m_cursorColumn - 1);
+        break;
+    case '\t':
+        // Tab stops every 8 columns; any gap is filled by the next print
+        m_cursorColumn = (m_cursorColumn / 8 + 1) * 8;
+        break;
+    default:
+        // BEL and the rest have nothing to show
+        break;
+    }
+}
+
+void TerminalFrontend::csiDispatch(char prefix, const int* params, int count, char intermediate, char final)
+{
+    // Private modes (ESC [ ? ...) and the like are not emulated
+    if (prefix || intermediate) {
+        return;
+    }
+    // Count parameters default to 1, selective ones to 0
+    const int first = count > 0 ? params[0] : -1;
+    const int amount = first > 0 ? first : 1;
+    const int mode = first > 0 ? first : 0;
+    
+    switch (final) {
+    case 'm':
+        m_style.applySgr(params, count);
+        break;
+    case 'K':
+        eraseInLine(mode);
+        break;
+    case 'J':
+        // Clearing the scrollback (as `clear` does) clears the output; the
+        // visible screen can't be told apart from it
+        if (mode == 3) {
+            clearOutput();
+        }
+        break;
+    case 'C':
+        m_cursorColumn += amount;
+        break;
+    case 'D':
+        m_cursorColumn = qMax(0, m_cursorColumn - amount);
+        break;
+    case 'G':
+    case '`':
+        m_cursorColumn = amount - 1;
+        break;
+    case 'P':
+        m_scrollback.remove(m_cursorColumn, amount);
+        damageLine(m_scrollback.lineCount() - 1);
+        break;
+    case 'X': {
+        // Erase characters: overwrite with blanks, leaving the cursor
+        const int column = m_cursorColumn;
+        const CellStyle style = m_style;
+        m_style = CellStyle();
+        const QString blanks(amount, QLatin1Char(' '));
+        print(blanks.constData(), blanks.size());
+        m_style = style;
+        m_cursorColumn = column;
+        break;
+    }
+    default:
+        // Cursor addressing across rows, scrolling regions and so on
+        break;
+    }
+}
+
+void TerminalFrontend::newLine()
+{
+    highlightDiagnostic();
+    // There are no rows to move between, so a line feed always starts a
+    // new line at the end, as if in newline mode
+    if (m_scrollback.newLine()) {
+        ++m_droppedLines;
+        if (m_firstDamagedLine > 0) {
+            --m_firstDamagedLine;
+        }
+    }
+    m_cursorColumn = 0;
+    damageLine(m_scrollback.lineCount() - 1);
+}
+
+void TerminalFrontend::highlightDiagnostic()
+{
+    // Use red for error messages and yellow for warnings wherever the
+    // program left the default color. Done once the line is complete, so
+    // painting doesn't search every line in view.
+    const QString& text = m_scrollback.lastLine().text;
+    if (text.contains(u"Error:", Qt::CaseInsensitive)) {
+        m_scrollback.setDefaultForeground(CellStyle::RgbColor | 0xf44336);
+    } else if (text.contains(u"Warning:", Qt::CaseInsensitive)) {
+        m_scrollback.setDefaultForeground(CellStyle::RgbColor | 0xffc107);
+    }
+}
+
+void TerminalFrontend::eraseInLine(int mode)
+{
+    if (mode == 0) {
+        // Cursor to end of line
+        m_scrollback.truncate(m_cursorColumn);
+    } else if (mode == 1) {
+        // Start of line through the cursor
+        const int column = m_cursorColumn;
+        const int length = qMin<int>(m_cursorColumn + 1, m_scrollback.lastLine().text.size());
+        const CellStyle style = m_style;
+        m_style = CellStyle();
+        m_cursorColumn = 0;
+        const QString blanks(length, QLatin1Char(' '));
+        print(blanks.constData(), blanks.size());
+        m_style = style;
+        m_cursorColumn = column;
+    } else if (mode == 2) {
+        m_scrollback.truncate(0);
+    }
+    damageLine(m_scrollback.lineCount() - 1);
+}
+
+void TerminalFrontend::clearOutput()
+{
+    m_scrollback.clear();
+    m_cursorColumn = 0;
+    m_firstDamagedLine = -1;
+    m_droppedLines = 0;
+    updateScrollRange();
+    // Reset scroll position
+    QScrollBar* vbar = verticalScrollBar();
+    if (vbar) {
+        vbar->setValue(0);
+    }
+    viewport()->update();
 }
 
 QString TerminalFrontend::getCurrentDirectory() const
@@ -682,6 +1036,18 @@ void TerminalFrontend::forceOpen()
     setMinimumHeight(0);
 }
 
+void TerminalFrontend::setScrollbackLimit(int lines)
+{
+    if (lines == m_scrollback.capacity()) {
+        return;
+    }
+    // Dropping old lines moves everything, so redraw it all
+    m_scrollback.setCapacity(lines);
+    m_droppedLines = 0;
+    m_firstDamagedLine = 0;
+    outputChanged();
+}
+
 void TerminalFrontend::updateHeaderButtons()
 {
     if (m_collapseButton) {
@@ -691,84 +1057,120 @@ void TerminalFrontend::updateHeaderButtons()
 
 void TerminalFrontend::paintEvent(QPaintEvent* event)
 {
-    // Don't paint content if collapsed
-    if (m_isCollapsed) {
+    // Don't paint content if collapsed, and keep it blank when empty
+    if (m_isCollapsed || m_scrollback.isEmpty()) {
         return;
     }
     
-    QPainter painter(viewport());
-    
-    // Set font for terminal output - use stored font size
-    QFont font("Consolas", m_fontSize);
-    painter.setFont(font);
-    
-    QRect viewportRect = viewport()->rect();
-    QFontMetrics fm(font);
-    int lineHeight = fm.height();
-    
-    // Account for header bar at top (30px height + 2px top margin = 32px offset)
-    int headerHeight = m_headerBar ? 32 : 0;
+    // Only the rows in the part that needs painting are drawn: scrolling
+    // exposes a strip at one edge and new output the rows that changed
+    const QRect area = outputRect();
+    const QRect dirty = event->rect().intersected(area);
+    if (dirty.isEmpty()) {
+        return;
+    }
     
-    // Account for input container at bottom
-    int inputHeight = m_inputContainer ? m_inputContainer->height() : 0;
-    // Available height excludes header and input
-    int availableHeight = viewportRect.height() - inputHeight - headerHeight;
+    QPainter painter(viewport());
     
-    // Account for scrollbar width on the right
+    // Clip text to available width to prevent cutoff from scrollbar
     int scrollbarWidth = verticalScrollBar()->isVisible() ? verticalScrollBar()->width() : 0;
-    int availableWidth = viewportRect.width() - scrollbarWidth - 10; // 10px right margin
+    int x = 10; // Left margin
+    painter.setClipRect(dirty.intersected(QRect(0, area.top(), area.width() - scrollbarWidth, area.height())));
     
-    // Calculate total content height for scrolling
-    int totalLines = 0;
-    if (!m_output.isEmpty()) {
-        totalLines = m_output.split('\n').count();
-    }
-    // No placeholder text - keep it blank when empty
-    int totalContentHeight = totalLines * lineHeight + 20; // Add some padding
+    // Get text color based on theme; colors the program chose take precedence
+    const QColor normalTextColor = palette().color(QPalette::Text);
     
-    // Set up scroll area range
-    QScrollBar* vbar = verticalScrollBar();
-    if (vbar) {
-        vbar->setRange(0, qMax(0, totalContentHeight - availableHeight));
-        vbar->setPageStep(availableHeight);
-        vbar->setSingleStep(lineHeight);
+    const int top = lineTop(0);
+    const int firstLine = qMax(0, (dirty.top() - top) / m_lineHeight);
+    const int lastLine = qMin(m_scrollback.lineCount() - 1, (dirty.bottom() - top) / m_lineHeight);
+    for (int i = firstLine; i <= lastLine; ++i) {
+        drawStyledLine(painter, x, top + i * m_lineHeight, m_scrollback.line(i), normalTextColor);
     }
+}
+
+void TerminalFrontend::drawStyledLine(QPainter& painter, qreal x, int top, const Scrollback::Line& line,
+                                      const QColor& defaultColor)
+{
+    // Every QChar takes one cell, so runs are placed by column and nothing
+    // past the right edge needs laying out
+    const qreal right = painter.clipBoundingRect().right();
+    const int end = qMin<int>(line.text.size(), qMax(0, int((right - x) / m_cellWidth) + 1));
+    auto span = line.spans.cbegin();
+    CellStyle style;
     
-    // Get the scroll offset
-    int scrollOffset = vbar ? vbar->value() : 0;
-    
-    // Draw the output text
-    if (!m_output.isEmpty()) {
-        // Start drawing below the header bar (account for header height + top margin)
-        int y = headerHeight + lineHeight - scrollOffset;
-        int x = 10; // Left margin
-        
-        // Get text color based on theme
-        QColor normalTextColor;
-        QPalette palette = this->palette();
-        normalTextColor = palette.color(QPalette::Text);
-        
-        // Split output into lines and draw each line
-        QStringList lines = m_output.split('\n');
-        for (const QString& line : lines) {
-            // Only draw if line is within visible area (accounting for header)
-            if (y + lineHeight >= headerHeight && y <= availableHeight + headerHeight) {
-                // Use red color for error messages, yellow for warnings, theme-appropriate color for regular output
-                if (line.contains("Error:", Qt::CaseInsensitive)) {
-                    painter.setPen(QColor(244, 67, 54)); // Red for errors
-                } else if (line.contains("Warning:", Qt::CaseInsensitive)) {
-                    painter.setPen(QColor(255, 193, 7)); // Yellow/amber for warnings
-                } else {
-                    painter.setPen(normalTextColor); // Use theme-appropriate text color
-                }
-                // Clip text to available width to prevent cutoff from scrollbar
-                QString clippedLine = fm.elidedText(line, Qt::ElideRight, availableWidth);
-                painter.drawText(x, y, clippedLine);
+    int position = 0;
+    while (position < end) {
+        const bool isSpanInLine = span != line.spans.cend() && span->start < end;
+        const int next = isSpanInLine ? span->start : end;
+        if (next > position) {
+            QColor foreground = CellStyle::color(style.foreground, defaultColor);
+            QColor background = CellStyle::color(style.background, QColor());
+            if (style.has(CellStyle::Inverse)) {
+                const QColor swapped = background.isValid() ? background : m_backgroundColor;
+                background = foreground;
+                foreground = swapped;
+            }
+            if (style.has(CellStyle::Dim)) {
+                foreground.setAlpha(160);
             }
-            y += lineHeight;
+            
+            const qreal left = x + position * m_cellWidth;
+            if (background.isValid()) {
+                painter.fillRect(QRectF(left, top, (next - position) * m_cellWidth, m_lineHeight), background);
+            }
+            const int variant = fontVariant(style);
+            painter.setFont(m_fonts[variant]);
+            painter.setPen(foreground);
+            painter.drawStaticText(QPointF(left, top), staticText(line.text.mid(position, next - position), variant));
+        }
+        if (isSpanInLine) {
+            style = span->style;
+            ++span;
         }
+        position = next;
     }
-    // Don't draw anything when output is empty - keep it blank
+}
+
+const QStaticText& TerminalFrontend::staticText(const QString& text, int variant)
+{
+    // Laying text out is most of the cost of drawing it; the pen is applied
+    // when drawing, so one entry serves every color
+    QCache<QString, QStaticText>& cache = m_textCaches[variant];
+    QStaticText* cached = cache.object(text);
+    if (!cached) {
+        cached = new QStaticText(text);
+        cached->setTextFormat(Qt::PlainText);
+        cached->prepare(QTransform(), m_fonts[variant]);
+        cache.insert(text, cached);
+    }
+    return *cached;
+}
+
+int TerminalFrontend::fontVariant(const CellStyle& style)
+{
+    return (style.has(CellStyle::Bold) ? 1 : 0) | (style.has(CellStyle::Italic) ? 2 : 0)
+        | (style.has(CellStyle::Underline) ? 4 : 0) | (style.has(CellStyle::Strikeout) ? 8 : 0);
+}
+
+void TerminalFrontend::updateFontMetrics()
+{
+    QFont font("Consolas", m_fontSize);
+    // Output is laid out in cells, so make sure any fallback is monospaced too
+    font.setStyleHint(QFont::Monospace);
+    font.setFixedPitch(true);
+    for (int i = 0; i < FontVariants; ++i) {
+        m_fonts[i] = font;
+        m_fonts[i].setBold(i & 1);
+        m_fonts[i].setItalic(i & 2);
+        m_fonts[i].setUnderline(i & 4);
+        m_fonts[i].setStrikeOut(i & 8);
+        m_textCaches[i].clear();
+    }
+    
+    QFontMetricsF fm(font);
+    m_cellWidth = qMax<qreal>(1, fm.horizontalAdvance(QLatin1Char('M')));
+    m_lineHeight = qMax(1, qCeil(fm.height()));
+    m_descent = qCeil(fm.descent());
 }
 
 void TerminalFrontend::updateFontSize(int size)
@@ -778,7 +1180,10 @@ void TerminalFrontend::updateFontSize(int size)
         if (m_inputLine) {
             m_inputLine->setFont(QFont("Consolas", m_fontSize));
         }
-        update(); // Trigger repaint with new font size
+        updateFontMetrics();
+        updateTerminalSize();
+        updateScrollRange();
+        viewport()->update(); // Trigger repaint with new font size
     }
 }
 
@@ -2,14 +2,38 @@
 #include "terminal/UnixTerminalBackend.hpp"
 #include <QString>
 #include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QProcessEnvironment>
+#include <QSocketNotifier>
+#include <QThread>
+#include <vector>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#if defined(__APPLE__)
+#include <util.h>
+#elif defined(__FreeBSD__)
+#include <libutil.h>
+#else
+#include <pty.h>
+#endif
 
 using namespace openide::terminal;
 
 // Constructor: Initialize process
 UnixTerminalBackend::UnixTerminalBackend()
     : TerminalBackendInterface()
-    , m_process(nullptr)
     , m_shellPath()
+    , m_shellPid(-1)
+    , m_masterFd(-1)
+    , m_readNotifier(nullptr)
+    , m_writeNotifier(nullptr)
+    , m_columns(80)
+    , m_rows(24)
 {
     // Find available shell
     m_shellPath = findShell();
@@ -19,10 +43,6 @@ UnixTerminalBackend::UnixTerminalBackend()
 UnixTerminalBackend::~UnixTerminalBackend()
 {
     close();
-    if (m_process) {
-        delete m_process;
-        m_process = nullptr;
-    }
 }
 
 // Find an available shell (bash, zsh, sh) with fallbacks
@@ -56,35 +76,249 @@ QString UnixTerminalBackend::findShell()
     return "/bin/sh";  // POSIX sh should always exist on Unix systems
 }
 
-// Initialize - no-op for QProcess approach
+// Initialize - start the shell session unless one is running
 void UnixTerminalBackend::init()
 {
+    if (hasSession()) {
+        return;
+    }
+    
     // Verify shell is still available
     if (m_shellPath.isEmpty() || !QFileInfo::exists(m_shellPath)) {
         m_shellPath = findShell();
     }
     m_isInitialized = true;
+    
+    // Without a pseudo-terminal, startCommand runs each command on its own
+    startSession();
 }
 
-// Close - no-op for QProcess approach
+// Close - hang up the shell session
 void UnixTerminalBackend::close()
 {
-    if (m_process && m_process->state() != QProcess::NotRunning) {
-        m_process->kill();
-        m_process->waitForFinished(1000);
+    if (hasSession()) {
+        endSession();
+        reapShell(true);
     }
     TerminalBackendInterface::close();
 }
 
-// Execute a command and return output
-QString UnixTerminalBackend::executeCommand(const QString& command, const QString& workingDirectory)
+bool UnixTerminalBackend::startSession()
+{
+    // Everything the child needs is built before forking, since only
+    // async-signal-safe calls are allowed between fork and exec
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    // The frontend parses colors and line editing, not full-screen
+    // cursor addressing, but programs only color their output for a
+    // terminal type they recognize
+    environment.insert("TERM", "xterm-256color");
+    environment.insert("COLORTERM", "truecolor");
+    // Which makes git log, git diff and man start a full-screen pager that
+    // would draw garbage here, so have them print straight through
+    environment.insert("PAGER", "cat");
+    environment.insert("GIT_PAGER", "cat");
+    environment.insert("MANPAGER", "cat");
+    const QStringList variables = environment.toStringList();
+    std::vector<QByteArray> envStorage;
+    envStorage.reserve(variables.size());
+    for (const QString& variable : variables) {
+        envStorage.push_back(variable.toLocal8Bit());
+    }
+    std::vector<char*> envp;
+    envp.reserve(envStorage.size() + 1);
+    for (QByteArray& variable : envStorage) {
+        envp.push_back(variable.data());
+    }
+    envp.push_back(nullptr);
+    
+    QByteArray shell = QFile::encodeName(m_shellPath);
+    char* argv[] = { shell.data(), nullptr };
+    const QByteArray workingDirectory = QFile::encodeName(
+        m_workingDirectory.isEmpty() ? QDir::currentPath() : m_workingDirectory);
+    
+    struct winsize size = {};
+    size.ws_col = static_cast<unsigned short>(m_columns);
+    size.ws_row = static_cast<unsigned short>(m_rows);
+    
+    int masterFd = -1;
+    const pid_t pid = forkpty(&masterFd, nullptr, nullptr, &size);
+    if (pid < 0) {
+        return false;
+    }
+    if (pid == 0) {
+        // Child: the pseudo-terminal is already its controlling tty and
+        // standard streams
+        // Dispositions and the mask are inherited through exec, and the IDE
+        // changes some (Qt ignores SIGPIPE once a QProcess has run), so give
+        // the shell the defaults; otherwise `yes | head` reports broken pipes
+        for (int signalNumber = 1; signalNumber < NSIG; ++signalNumber) {
+            if (signalNumber != SIGKILL && signalNumber != SIGSTOP) {
+                signal(signalNumber, SIG_DFL);
+            }
+        }
+        sigset_t signalMask;
+        sigemptyset(&signalMask);
+        sigprocmask(SIG_SETMASK, &signalMask, nullptr);
+        // If the directory has gone the shell starts where the IDE runs
+        const int chdirResult = chdir(workingDirectory.constData());
+        Q_UNUSED(chdirResult);
+        execve(argv[0], argv, envp.data());
+        _exit(127);
+    }
+    
+    fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+    fcntl(masterFd, F_SETFD, FD_CLOEXEC);
+    m_shellPid = pid;
+    m_masterFd = masterFd;
+    
+    m_readNotifier = new QSocketNotifier(m_masterFd, QSocketNotifier::Read, this);
+    connect(m_readNotifier, &QSocketNotifier::activated, this, [this]() { readOutput(); });
+    m_writeNotifier = new QSocketNotifier(m_masterFd, QSocketNotifier::Write, this);
+    m_writeNotifier->setEnabled(false);
+    connect(m_writeNotifier, &QSocketNotifier::activated, this, [this]() { flushInput(); });
+    return true;
+}
+
+void UnixTerminalBackend::readOutput()
+{
+    QByteArray output;
+    char buffer[64 * 1024];
+    bool isClosed = false;
+    while (output.size() < MaxReadPerNotification) {
+        const ssize_t count = ::read(m_masterFd, buffer, sizeof(buffer));
+        if (count > 0) {
+            output.append(buffer, count);
+            continue;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        // EOF, or EIO once the last process holding the tty has gone
+        isClosed = count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+    
+    if (!output.isEmpty()) {
+        emit outputReceived(output);
+    }
+    if (isClosed) {
+        endSession();
+        emit sessionFinished(reapShell(false));
+    }
+}
+
+void UnixTerminalBackend::writeInput(const QByteArray& data)
+{
+    if (!hasSession()) {
+        TerminalBackendInterface::writeInput(data);
+        return;
+    }
+    m_pendingInput.append(data);
+    flushInput();
+}
+
+void UnixTerminalBackend::flushInput()
+{
+    while (!m_pendingInput.isEmpty()) {
+        const ssize_t count = ::write(m_masterFd, m_pendingInput.constData(), m_pendingInput.size());
+        if (count > 0) {
+            m_pendingInput.remove(0, count);
+            continue;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            // The session is going away; readOutput will notice
+            m_pendingInput.clear();
+        }
+        break;
+    }
+    // Resume once the shell has read some of what is queued
+    m_writeNotifier->setEnabled(!m_pendingInput.isEmpty());
+}
+
+void UnixTerminalBackend::interrupt()
+{
+    if (!hasSession()) {
+        TerminalBackendInterface::interrupt();
+        return;
+    }
+    // Typed as Ctrl+C, so the tty sends SIGINT to the foreground job, or
+    // passes the byte on to a program reading raw input
+    writeInput(QByteArray(1, '\x03'));
+}
+
+void UnixTerminalBackend::setTerminalSize(int columns, int rows)
+{
+    if (columns <= 0 || rows <= 0 || (columns == m_columns && rows == m_rows)) {
+        return;
+    }
+    m_columns = columns;
+    m_rows = rows;
+    if (hasSession()) {
+        // The kernel passes this on to the foreground job as SIGWINCH
+        struct winsize size = {};
+        size.ws_col = static_cast<unsigned short>(m_columns);
+        size.ws_row = static_cast<unsigned short>(m_rows);
+        ioctl(m_masterFd, TIOCSWINSZ, &size);
+    }
+}
+
+void UnixTerminalBackend::endSession()
+{
+    // This may run from a notifier's own signal, so they go later
+    m_readNotifier->setEnabled(false);
+    m_readNotifier->deleteLater();
+    m_readNotifier = nullptr;
+    m_writeNotifier->setEnabled(false);
+    m_writeNotifier->deleteLater();
+    m_writeNotifier = nullptr;
+    m_pendingInput.clear();
+    if (m_masterFd >= 0) {
+        // Closing the master hangs up the tty, which signals its jobs
+        ::close(m_masterFd);
+        m_masterFd = -1;
+    }
+}
+
+int UnixTerminalBackend::reapShell(bool isHangingUp)
+{
+    const pid_t pid = m_shellPid;
+    m_shellPid = -1;
+    if (pid <= 0) {
+        return -1;
+    }
+    
+    if (isHangingUp) {
+        kill(pid, SIGHUP);
+    }
+    int status = 0;
+    pid_t result = 0;
+    // Give the shell a second to exit on its own
+    for (int i = 0; i < 100; ++i) {
+        result = waitpid(pid, &status, WNOHANG);
+        if (result != 0) {
+            break;
+        }
+        QThread::msleep(10);
+    }
+    if (result == 0) {
+        kill(pid, SIGKILL);
+        result = waitpid(pid, &status, 0);
+    }
+    if (result != pid) {
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+// Start a command in its own shell
+bool UnixTerminalBackend::startCommand(const QString& command, const QString& workingDirectory)
 {
     // Verify shell is still available
     if (m_shellPath.isEmpty() || !QFileInfo::exists(m_shellPath)) {
         m_shellPath = findShell();
-        if (m_shellPath.isEmpty()) {
-            return QString("Error: No shell found. Please ensure bash, zsh, or sh is installed.");
-        }
     }
     
     // Determine shell name for -c flag
@@ -104,8 +338,8 @@ QString UnixTerminalBackend::executeCommand(const QString& command, const QStrin
         arguments << "-c" << command;
     }
     
-    // Use the common executeProcess helper
-    return executeProcess(program, arguments, workingDirectory);
+    // Use the common startProcess helper
+    return startProcess(program, arguments, workingDirectory);
 }
 
 #endif // !WIN32
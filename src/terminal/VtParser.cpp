@@ -0,0 +1,376 @@
+#include "terminal/VtParser.hpp"
+
+using namespace openide::terminal;
+
+namespace
+{
+constexpr uchar Escape = 0x1b;
+constexpr uchar Bell = 0x07;
+constexpr uchar Cancel = 0x18;
+constexpr uchar Substitute = 0x1a;
+constexpr uchar Delete = 0x7f;
+constexpr char32_t ReplacementCharacter = 0xfffd;
+constexpr int MaxParamValue = 65535;
+}
+
+VtParser::VtParser(Handler* handler)
+    : m_handler(handler)
+    , m_state(State::Ground)
+    , m_paramCount(0)
+    , m_prefix(0)
+    , m_intermediate(0)
+    , m_stringEscape(false)
+    , m_codePoint(0)
+    , m_pendingBytes(0)
+    , m_minimumCodePoint(0)
+    , m_textLength(0)
+{
+    clearSequence();
+}
+
+void VtParser::reset()
+{
+    m_state = State::Ground;
+    clearSequence();
+    m_stringEscape = false;
+    m_pendingBytes = 0;
+    m_textLength = 0;
+}
+
+void VtParser::feed(const char* data, qsizetype size)
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>(data);
+    for (qsizetype i = 0; i < size; ++i)
+    {
+        const uchar byte = bytes[i];
+        // Text is by far the most common case, so it is tested first
+        if (m_state == State::Ground && byte >= 0x20 && byte != Delete)
+        {
+            decodeText(byte);
+            continue;
+        }
+        if (m_state == State::OscString || m_state == State::IgnoreString)
+        {
+            handleString(byte);
+            continue;
+        }
+        if (byte < 0x20 || byte == Delete)
+        {
+            handleControl(byte);
+            continue;
+        }
+        if (byte >= 0x80)
+        {
+            // Not part of any sequence
+            continue;
+        }
+        switch (m_state)
+        {
+        case State::Escape:
+        case State::EscapeIntermediate:
+            handleEscape(byte);
+            break;
+        default:
+            handleCsi(byte);
+            break;
+        }
+    }
+    // Handlers only ever see whole characters
+    flushText();
+}
+
+void VtParser::handleControl(uchar byte)
+{
+    if (m_pendingBytes > 0)
+    {
+        // A character cut short by the control
+        m_pendingBytes = 0;
+        appendCodePoint(ReplacementCharacter);
+    }
+    
+    switch (byte)
+    {
+    case Escape:
+        flushText();
+        clearSequence();
+        m_state = State::Escape;
+        break;
+    case Cancel:
+    case Substitute:
+        // Abandon any sequence in progress
+        m_state = State::Ground;
+        break;
+    case Delete:
+        break;
+    default:
+        // Executed even in the middle of a sequence, which then carries on
+        flushText();
+        m_handler->execute(char(byte));
+        break;
+    }
+}
+
+void VtParser::handleEscape(uchar byte)
+{
+    if (byte <= 0x2f)
+    {
+        m_intermediate = char(byte);
+        m_state = State::EscapeIntermediate;
+        return;
+    }
+    
+    if (m_state == State::Escape)
+    {
+        switch (byte)
+        {
+        case '[':
+            m_state = State::CsiEntry;
+            return;
+        case ']':
+            m_oscData.clear();
+            m_state = State::OscString;
+            return;
+        case 'P':
+        case 'X':
+        case '^':
+        case '_':
+            m_state = State::IgnoreString;
+            return;
+        default:
+            break;
+        }
+    }
+    m_handler->escDispatch(m_intermediate, char(byte));
+    m_state = State::Ground;
+}
+
+void VtParser::handleCsi(uchar byte)
+{
+    if (m_state == State::CsiIgnore)
+    {
+        if (byte >= 0x40)
+        {
+            m_state = State::Ground;
+        }
+        return;
+    }
+    
+    if (byte >= 0x40)
+    {
+        dispatchCsi(byte);
+        m_state = State::Ground;
+        return;
+    }
+    if (byte <= 0x2f)
+    {
+        m_intermediate = char(byte);
+        m_state = State::CsiIntermediate;
+        return;
+    }
+    if (m_state == State::CsiIntermediate)
+    {
+        // Parameters can't follow intermediates
+        m_state = State::CsiIgnore;
+        return;
+    }
+    
+    if (byte >= 0x3c)
+    {
+        // A private marker, only valid right after ESC [
+        if (m_state == State::CsiEntry)
+        {
+            m_prefix = char(byte);
+            m_state = State::CsiParam;
+        }
+        else
+        {
+            m_state = State::CsiIgnore;
+        }
+        return;
+    }
+    
+    m_state = State::CsiParam;
+    if (m_paramCount == 0)
+    {
+        m_paramCount = 1;
+    }
+    if (byte >= '0' && byte <= '9')
+    {
+        int& param = m_params[m_paramCount - 1];
+        param = qMin((param < 0 ? 0 : param) * 10 + (byte - '0'), MaxParamValue);
+    }
+    else if (byte == ';' || byte == ':')
+    {
+        // Subparameters are read as plain parameters, which is how most
+        // programs expect 38:5:n to be taken anyway
+        if (m_paramCount < MaxParams)
+        {
+            ++m_paramCount;
+        }
+        else
+        {
+            m_state = State::CsiIgnore;
+        }
+    }
+}
+
+void VtParser::handleString(uchar byte)
+{
+    if (m_stringEscape)
+    {
+        m_stringEscape = false;
+        if (m_state == State::OscString)
+        {
+            m_handler->oscDispatch(m_oscData);
+        }
+        // ESC \ is the string terminator; any other escape ends the string
+        // and then starts as usual
+        clearSequence();
+        m_state = State::Escape;
+        if (byte == '\\')
+        {
+            m_state = State::Ground;
+        }
+        else if (byte < 0x20 || byte == Delete)
+        {
+            handleControl(byte);
+        }
+        else
+        {
+            handleEscape(byte);
+        }
+        return;
+    }
+    
+    switch (byte)
+    {
+    case Bell:
+        // xterm also ends OSC with BEL
+        if (m_state == State::OscString)
+        {
+            m_handler->oscDispatch(m_oscData);
+        }
+        m_state = State::Ground;
+        break;
+    case Escape:
+        m_stringEscape = true;
+        break;
+    case Cancel:
+    case Substitute:
+        m_state = State::Ground;
+        break;
+    default:
+        if (byte >= 0x20 && m_state == State::OscString && m_oscData.size() < MaxOscLength)
+        {
+            m_oscData.append(char(byte));
+        }
+        break;
+    }
+}
+
+void VtParser::clearSequence()
+{
+    for (int& param : m_params)
+    {
+        param = -1;
+    }
+    m_paramCount = 0;
+    m_prefix = 0;
+    m_intermediate = 0;
+}
+
+void VtParser::dispatchCsi(uchar final)
+{
+    m_handler->csiDispatch(m_prefix, m_params, m_paramCount, m_intermediate, char(final));
+}
+
+void VtParser::decodeText(uchar byte)
+{
+    if (byte < 0x80)
+    {
+        if (m_pendingBytes > 0)
+        {
+            m_pendingBytes = 0;
+            appendCodePoint(ReplacementCharacter);
+        }
+        if (m_textLength == TextBufferSize)
+        {
+            flushText();
+        }
+        m_text[m_textLength++] = QChar(char16_t(byte));
+        return;
+    }
+    
+    if (byte < 0xc0)
+    {
+        // Continuation byte
+        if (m_pendingBytes == 0)
+        {
+            appendCodePoint(ReplacementCharacter);
+            return;
+        }
+        m_codePoint = (m_codePoint << 6) | (byte & 0x3f);
+        if (--m_pendingBytes == 0)
+        {
+            const bool isValid = m_codePoint >= m_minimumCodePoint && m_codePoint <= 0x10ffff
+                && (m_codePoint < 0xd800 || m_codePoint > 0xdfff);
+            appendCodePoint(isValid ? m_codePoint : ReplacementCharacter);
+        }
+        return;
+    }
+    
+    if (m_pendingBytes > 0)
+    {
+        // A lead byte before the last character was complete
+        m_pendingBytes = 0;
+        appendCodePoint(ReplacementCharacter);
+    }
+    if (byte < 0xe0)
+    {
+        m_codePoint = byte & 0x1f;
+        m_pendingBytes = 1;
+        m_minimumCodePoint = 0x80;
+    }
+    else if (byte < 0xf0)
+    {
+        m_codePoint = byte & 0x0f;
+        m_pendingBytes = 2;
+        m_minimumCodePoint = 0x800;
+    }
+    else if (byte < 0xf5)
+    {
+        m_codePoint = byte & 0x07;
+        m_pendingBytes = 3;
+        m_minimumCodePoint = 0x10000;
+    }
+    else
+    {
+        appendCodePoint(ReplacementCharacter);
+    }
+}
+
+void VtParser::appendCodePoint(char32_t codePoint)
+{
+    if (m_textLength + 2 > TextBufferSize)
+    {
+        flushText();
+    }
+    if (QChar::requiresSurrogates(codePoint))
+    {
+        m_text[m_textLength++] = QChar(QChar::highSurrogate(codePoint));
+        m_text[m_textLength++] = QChar(QChar::lowSurrogate(codePoint));
+    }
+    else
+    {
+        m_text[m_textLength++] = QChar(char16_t(codePoint));
+    }
+}
+
+void VtParser::flushText()
+{
+    if (m_textLength > 0)
+    {
+        m_handler->print(m_text, m_textLength);
+        m_textLength = 0;
+    }
+}
@@ -5,26 +5,16 @@
 
 using namespace openide::terminal;
 
-// Constructor: Initialize process
+// Constructor
 WindowsTerminalBackend::WindowsTerminalBackend()
     : TerminalBackendInterface()
-    , m_process(nullptr)
 {
 }
 
 // Destructor: Ensure cleanup
 WindowsTerminalBackend::~WindowsTerminalBackend()
 {
-    if (m_process && m_process->state() != QProcess::NotRunning) {
-        m_process->kill();
-        m_process->waitForFinished(1000);
-    }
-    if (m_process) {
-        delete m_process;
-        m_process = nullptr;
-    }
-    // Set initialized state directly (avoiding virtual call)
-    m_isInitialized = false;
+    close();
 }
 
 // Initialize - no-op for QProcess approach
@@ -33,13 +23,9 @@ void WindowsTerminalBackend::init()
     m_isInitialized = true;
 }
 
-// Close - no-op for QProcess approach
+// Close - stops the running command
 void WindowsTerminalBackend::close()
 {
-    if (m_process && m_process->state() != QProcess::NotRunning) {
-        m_process->kill();
-        m_process->waitForFinished(1000);
-    }
     TerminalBackendInterface::close();
 }
 
@@ -60,8 +46,8 @@ QString WindowsTerminalBackend::platformSpecificCleanOutput(const QString& outpu
     return cleaned;
 }
 
-// Execute a command and return output
-QString WindowsTerminalBackend::executeCommand(const QString& command, const QString& workingDirectory)
+// Start a command in its own PowerShell
+bool WindowsTerminalBackend::startCommand(const QString& command, const QString& workingDirectory)
 {
     // Set up the process to run PowerShell with the command
     // Use -NoProfile -NonInteractive -Command to execute the command and suppress extra output
@@ -69,8 +55,8 @@ QString WindowsTerminalBackend::executeCommand(const QString& command, const QSt
     QStringList arguments;
     arguments << "-NoProfile" << "-NonInteractive" << "-Command" << command;
     
-    // Use the common executeProcess helper
-    return executeProcess(program, arguments, workingDirectory);
+    // Use the common startProcess helper
+    return startProcess(program, arguments, workingDirectory);
 }
 
 #endif // WIN32